@@ -1,5 +1,7 @@
 #include "plugin.h"
 #include "authenticationrequest.h"
+#include "dispatcher.h"
+#include "network.h"
 #include "resourcesmodel.h"
 #include "resourcesrequest.h"
 #include "streamsmodel.h"
@@ -15,6 +17,8 @@ void Plugin::registerTypes(const char *uri) {
     Q_ASSERT(uri == QLatin1String("QVimeo"));
 
     qmlRegisterType<AuthenticationRequest>(uri, 1, 0, "AuthenticationRequest");
+    qmlRegisterType<Dispatcher>(uri, 1, 0, "Dispatcher");
+    qmlRegisterType<Network>(uri, 1, 0, "Network");
     qmlRegisterType<ResourcesModel>(uri, 1, 0, "ResourcesModel");
     qmlRegisterType<ResourcesRequest>(uri, 1, 0, "ResourcesRequest");
     qmlRegisterType<StreamsModel>(uri, 1, 0, "StreamsModel");
@@ -24,6 +28,8 @@ void Plugin::registerTypes(const char *uri) {
 }
 
 QML_DECLARE_TYPE(QVimeo::AuthenticationRequest)
+QML_DECLARE_TYPE(QVimeo::Dispatcher)
+QML_DECLARE_TYPE(QVimeo::Network)
 QML_DECLARE_TYPE(QVimeo::ResourcesModel)
 QML_DECLARE_TYPE(QVimeo::ResourcesRequest)
 QML_DECLARE_TYPE(QVimeo::StreamsModel)
@@ -34,15 +34,27 @@ public:
     {
     }
     
+    bool canParseIncrementally() const {
+        return false;
+    }
+    
+    bool canCacheResult() const {
+        return false;
+    }
+    
     void _q_onReplyFinished() {
         if (!reply) {
             return;
         }
+        
+        if (redirectOrRetry()) {
+            return;
+        }
     
         Q_Q(AuthenticationRequest);
     
         bool ok;
-        setResult(QtJson::Json::parse(reply->readAll(), ok));
+        setResult(QtJson::Json::parse(readReply(), ok));
         
         const QNetworkReply::NetworkError e = reply->error();
         const QString es = reply->errorString();
@@ -53,9 +65,7 @@ public:
         case QNetworkReply::NoError:
             break;
         case QNetworkReply::OperationCanceledError:
-            setStatus(Request::Canceled);
-            setError(Request::NoError);
-            setErrorString(QString());
+            setCanceled();
             emit q->finished();
             return;
         default:
@@ -0,0 +1,342 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cache_p.h"
+#include <QCache>
+#include <QDateTime>
+#include <QMap>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QStringList>
+#ifdef QVIMEO_DEBUG
+#include <QDebug>
+#endif
+
+namespace QVimeo {
+
+static const int DEFAULT_MAX_CACHE_SIZE = 10 * 1024 * 1024;
+
+struct CacheData
+{
+    CacheData() :
+        hits(0),
+        revalidations(0),
+        misses(0)
+    {
+        entries.setMaxCost(DEFAULT_MAX_CACHE_SIZE);
+    }
+
+    QMutex mutex;
+    QCache<QString, CacheEntry> entries;
+    QMap<QString, int> timeToLive;
+    int hits;
+    int revalidations;
+    int misses;
+};
+
+Q_GLOBAL_STATIC(CacheData, cacheData)
+
+static int findTimeToLive(const CacheData *data, const QString &path) {
+    // The longest matching prefix wins
+    int ttl = 0;
+    int length = -1;
+    QMapIterator<QString, int> iterator(data->timeToLive);
+
+    while (iterator.hasNext()) {
+        iterator.next();
+
+        if ((iterator.key().size() > length) && (path.startsWith(iterator.key()))) {
+            ttl = iterator.value();
+            length = iterator.key().size();
+        }
+    }
+
+    return ttl;
+}
+
+/*!
+    \class Cache
+    \brief Stores the parsed results of GET requests in memory.
+
+    \ingroup requests
+
+    When Request::cacheEnabled is set, the parsed result of each successful GET request is stored, keyed by the 
+    URL, the access token and the way the result is represented. When the same URL is requested again:
+
+    \list
+        \o If the result is younger than the timeToLive() of its resource path, it is used without making 
+           a network request.
+        \o Otherwise, if the response had an ETag or Last-Modified header, the request includes If-None-Match 
+           and If-Modified-Since headers, and if the server responds with 304 Not Modified, the stored result 
+           is used without being downloaded or parsed again.
+    \endlist
+
+    Results are discarded, least recently used first, when the size of the cache exceeds maximumSize(). When a 
+    request that modifies a resource succeeds, the results for the resource, the resources below it and the 
+    collection that contains it are also discarded. For example, deleting /videos/123 discards the results 
+    for /videos/123, /videos/123/comments and /videos. Other lists that contain the resource, such as 
+    /me/videos, cannot be identified, so their results may be stale until their timeToLive() has passed. Use 
+    remove() to discard them, as ResourcesModel does for its own resourcePath after a change.
+
+    The cache is shared by all requests in the process.
+
+    \sa Request::cacheEnabled
+*/
+
+/*!
+    \brief Returns the number of results in the cache.
+*/
+int Cache::count() {
+    CacheData *data = cacheData();
+    QMutexLocker locker(&data->mutex);
+
+    return data->entries.size();
+}
+
+/*!
+    \brief Returns the size of the results in the cache, in bytes.
+
+    The size of each result is taken to be the size of the response from which it was parsed.
+*/
+int Cache::size() {
+    CacheData *data = cacheData();
+    QMutexLocker locker(&data->mutex);
+
+    return data->entries.totalCost();
+}
+
+/*!
+    \brief Returns the maximum size of the results in the cache, in bytes.
+
+    The default is 10MB.
+
+    \sa setMaximumSize()
+*/
+int Cache::maximumSize() {
+    CacheData *data = cacheData();
+    QMutexLocker locker(&data->mutex);
+
+    return data->entries.maxCost();
+}
+
+/*!
+    \brief Sets the maximum size of the results in the cache to \a bytes.
+
+    If the cache is larger than \a bytes, the least recently used results are discarded.
+
+    \sa maximumSize()
+*/
+void Cache::setMaximumSize(int bytes) {
+    CacheData *data = cacheData();
+    QMutexLocker locker(&data->mutex);
+    data->entries.setMaxCost(qMax(0, bytes));
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::Cache::setMaximumSize" << bytes;
+#endif
+}
+
+/*!
+    \brief Returns the number of seconds for which results for \a resourcePath are used without being 
+    revalidated.
+
+    \sa setTimeToLive()
+*/
+int Cache::timeToLive(const QString &resourcePath) {
+    CacheData *data = cacheData();
+    QMutexLocker locker(&data->mutex);
+
+    return findTimeToLive(data, resourcePath);
+}
+
+/*!
+    \brief Sets the number of seconds for which results for resource paths beginning with \a pathPrefix are 
+    used without being revalidated to \a seconds.
+
+    When several prefixes match a resource path, the longest is used. For example:
+
+    \code
+    Cache::setTimeToLive("/", 60);
+    Cache::setTimeToLive("/me/videos", 300);
+    Cache::setTimeToLive("/me/feed", 0);
+    \endcode
+
+    The default is 0 for all resource paths, meaning that results are always revalidated.
+
+    \sa timeToLive()
+*/
+void Cache::setTimeToLive(const QString &pathPrefix, int seconds) {
+    CacheData *data = cacheData();
+    QMutexLocker locker(&data->mutex);
+    data->timeToLive.insert(pathPrefix, qMax(0, seconds));
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::Cache::setTimeToLive" << pathPrefix << seconds;
+#endif
+}
+
+/*!
+    \brief Returns the number of requests that used a result from the cache without making a network request.
+
+    \sa resetCounters()
+*/
+int Cache::hitCount() {
+    CacheData *data = cacheData();
+    QMutexLocker locker(&data->mutex);
+
+    return data->hits;
+}
+
+/*!
+    \brief Returns the number of requests that used a result from the cache after the server responded with 
+    304 Not Modified.
+
+    \sa resetCounters()
+*/
+int Cache::revalidationCount() {
+    CacheData *data = cacheData();
+    QMutexLocker locker(&data->mutex);
+
+    return data->revalidations;
+}
+
+/*!
+    \brief Returns the number of requests with the cache enabled whose result was downloaded in full.
+
+    \sa resetCounters()
+*/
+int Cache::missCount() {
+    CacheData *data = cacheData();
+    QMutexLocker locker(&data->mutex);
+
+    return data->misses;
+}
+
+/*!
+    \brief Resets the hitCount(), revalidationCount() and missCount() to 0.
+*/
+void Cache::resetCounters() {
+    CacheData *data = cacheData();
+    QMutexLocker locker(&data->mutex);
+    data->hits = 0;
+    data->revalidations = 0;
+    data->misses = 0;
+}
+
+/*!
+    \brief Removes the results for \a resourcePath, the resources below it and the collection that contains it.
+*/
+void Cache::remove(const QString &resourcePath) {
+    CachePrivate::removePath(resourcePath);
+}
+
+/*!
+    \brief Removes all results from the cache.
+*/
+void Cache::clear() {
+    CacheData *data = cacheData();
+    QMutexLocker locker(&data->mutex);
+    data->entries.clear();
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::Cache::clear";
+#endif
+}
+
+bool CachePrivate::find(const QString &key, CacheEntry *entry) {
+    CacheData *data = cacheData();
+    QMutexLocker locker(&data->mutex);
+    const CacheEntry *object = data->entries.object(key);
+
+    if (!object) {
+        return false;
+    }
+
+    *entry = *object;
+    return true;
+}
+
+bool CachePrivate::isFresh(const CacheEntry &entry) {
+    CacheData *data = cacheData();
+    QMutexLocker locker(&data->mutex);
+    const int ttl = findTimeToLive(data, entry.path);
+
+    return (ttl > 0) && (QDateTime::currentMSecsSinceEpoch() - entry.created < qint64(ttl) * 1000);
+}
+
+void CachePrivate::insert(const QString &key, const CacheEntry &entry) {
+    CacheData *data = cacheData();
+    QMutexLocker locker(&data->mutex);
+    CacheEntry *object = new CacheEntry(entry);
+    object->created = QDateTime::currentMSecsSinceEpoch();
+    // QCache deletes the object if it is larger than the maximum size
+    data->entries.insert(key, object, qMax(1, entry.cost));
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::CachePrivate::insert" << key << entry.cost << entry.etag << entry.lastModified;
+#endif
+}
+
+void CachePrivate::remove(const QString &key) {
+    CacheData *data = cacheData();
+    QMutexLocker locker(&data->mutex);
+    data->entries.remove(key);
+}
+
+void CachePrivate::removePath(const QString &path) {
+    QString resource = path;
+
+    while (resource.endsWith('/')) {
+        resource.chop(1);
+    }
+
+    if (resource.isEmpty()) {
+        return;
+    }
+
+    // The collection that contains the resource is also stale
+    const QString collection = resource.section('/', 0, -2);
+    CacheData *data = cacheData();
+    QMutexLocker locker(&data->mutex);
+
+    foreach (const QString &key, data->entries.keys()) {
+        const CacheEntry *object = data->entries.object(key);
+
+        if ((object) && ((object->path == resource) || (object->path.startsWith(resource + '/'))
+                         || ((!collection.isEmpty()) && (object->path == collection)))) {
+            data->entries.remove(key);
+        }
+    }
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::CachePrivate::removePath" << resource << collection;
+#endif
+}
+
+void CachePrivate::addHit() {
+    CacheData *data = cacheData();
+    QMutexLocker locker(&data->mutex);
+    data->hits++;
+}
+
+void CachePrivate::addRevalidation() {
+    CacheData *data = cacheData();
+    QMutexLocker locker(&data->mutex);
+    data->revalidations++;
+}
+
+void CachePrivate::addMiss() {
+    CacheData *data = cacheData();
+    QMutexLocker locker(&data->mutex);
+    data->misses++;
+}
+
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QVIMEO_CACHE_H
+#define QVIMEO_CACHE_H
+
+#include "qvimeo_global.h"
+#include <QString>
+
+namespace QVimeo {
+
+class QVIMEOSHARED_EXPORT Cache
+{
+
+public:
+    static int count();
+    static int size();
+
+    static int maximumSize();
+    static void setMaximumSize(int bytes);
+
+    static int timeToLive(const QString &resourcePath);
+    static void setTimeToLive(const QString &pathPrefix, int seconds);
+
+    static int hitCount();
+    static int revalidationCount();
+    static int missCount();
+    static void resetCounters();
+
+    static void remove(const QString &resourcePath);
+    static void clear();
+};
+
+}
+
+#endif // QVIMEO_CACHE_H
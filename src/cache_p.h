@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QVIMEO_CACHE_P_H
+#define QVIMEO_CACHE_P_H
+
+#include "cache.h"
+#include "json.h"
+
+namespace QVimeo {
+
+struct CacheEntry
+{
+    CacheEntry() :
+        created(0),
+        cost(0)
+    {
+    }
+
+    QString path;
+    qint64 created;
+    int cost;
+    QByteArray etag;
+    QByteArray lastModified;
+    QVariant result;
+    QtJson::JsonDocument document;
+};
+
+class CachePrivate
+{
+
+public:
+    static bool find(const QString &key, CacheEntry *entry);
+    static bool isFresh(const CacheEntry &entry);
+
+    static void insert(const QString &key, const CacheEntry &entry);
+
+    static void remove(const QString &key);
+    static void removePath(const QString &path);
+
+    static void addHit();
+    static void addRevalidation();
+    static void addMiss();
+};
+
+}
+
+#endif // QVIMEO_CACHE_P_H
@@ -0,0 +1,787 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dispatcher.h"
+#include "network.h"
+#include "ratelimit_p.h"
+#include "request_p.h"
+#include "urls.h"
+#include <QHash>
+#include <QPointer>
+#include <QTimer>
+#include <QUrl>
+#ifdef QVIMEO_DEBUG
+#include <QDebug>
+#endif
+
+namespace QVimeo {
+
+// Matches the number of connections QNetworkAccessManager opens to each host
+static const int DEFAULT_MAX_REQUESTS_PER_HOST = 6;
+// Matches the number of concurrent streams QNetworkAccessManager allows on each HTTP/2 connection
+static const int DEFAULT_MAX_STREAMS_PER_HOST = 100;
+
+class DispatcherPrivate
+{
+
+public:
+    enum JobType {
+        ListJob = 0,
+        GetJob,
+        InsertJob,
+        InsertResourceJob,
+        UpdateJob,
+        DeleteJob,
+        StreamsJob
+    };
+
+    struct Job {
+        JobType type;
+        QPointer<Request> request;
+        QString host;
+        QString path;
+        QVariantMap map;
+    };
+
+    DispatcherPrivate(Dispatcher *parent) :
+        q_ptr(parent),
+        manager(0),
+        maximumRequestsPerHost(DEFAULT_MAX_REQUESTS_PER_HOST),
+        maximumStreamsPerHost(DEFAULT_MAX_STREAMS_PER_HOST),
+        timeout(0),
+        readTimeout(0),
+        starting(false),
+        startScheduled(false)
+    {
+    }
+
+    ResourcesRequest* addResourcesJob(JobType type, const QString &path, const QVariantMap &map = QVariantMap()) {
+        Q_Q(Dispatcher);
+
+        Job job;
+        job.type = type;
+        job.request = new ResourcesRequest(q);
+        job.host = QUrl(API_URL).host();
+        job.path = path;
+        job.map = map;
+        enqueue(job);
+
+        return qobject_cast<ResourcesRequest*>(job.request);
+    }
+
+    void enqueue(const Job &job) {
+        Q_Q(Dispatcher);
+
+        queue.append(job);
+        Dispatcher::connect(job.request, SIGNAL(destroyed(QObject*)), q, SLOT(_q_onRequestDestroyed(QObject*)));
+#ifdef QVIMEO_DEBUG
+        qDebug() << "QVimeo::DispatcherPrivate::enqueue" << job.type << job.host << job.path;
+#endif
+        startJobs();
+        emit q->countChanged();
+    }
+
+    void startJobs() {
+        // Requests that fail immediately finish while their job is being started
+        if (starting) {
+            return;
+        }
+
+        starting = true;
+        int i = 0;
+
+        while (i < queue.size()) {
+            const Job &job = queue.at(i);
+
+            // Requests deleted by the caller before they were started
+            if (!job.request) {
+                queue.removeAt(i);
+                continue;
+            }
+
+            if (active.value(job.host) >= maximumActiveRequests(job.host)) {
+                i++;
+                continue;
+            }
+
+            if (job.type != StreamsJob) {
+                // Spread the API requests over the rest of the rate limit window
+                const int delay = RateLimit::delay(accessToken);
+
+                if (delay > 0) {
+                    scheduleStart(delay);
+                    i++;
+                    continue;
+                }
+
+                RateLimitPrivate::addRequest(accessToken);
+            }
+
+            startJob(queue.takeAt(i));
+        }
+
+        starting = false;
+    }
+
+    int maximumActiveRequests(const QString &host) const {
+        return Network::isMultiplexed(host) ? maximumStreamsPerHost : maximumRequestsPerHost;
+    }
+
+    void scheduleStart(int delay) {
+        if (!startScheduled) {
+            Q_Q(Dispatcher);
+            startScheduled = true;
+#ifdef QVIMEO_DEBUG
+            qDebug() << "QVimeo::DispatcherPrivate::scheduleStart" << delay;
+#endif
+            QTimer::singleShot(delay, q, SLOT(_q_startJobs()));
+        }
+    }
+
+    void startJob(const Job &job) {
+        Q_Q(Dispatcher);
+
+        Request *request = job.request;
+
+        if (!request) {
+            return;
+        }
+
+        request->setClientId(clientId);
+        request->setClientSecret(clientSecret);
+        request->setAccessToken(accessToken);
+        request->setNetworkAccessManager(manager);
+        request->setTimeout(timeout);
+        request->setReadTimeout(readTimeout);
+        request->setRetryPolicy(retryPolicy);
+
+        active[job.host]++;
+        activeRequests.insert(request, job.host);
+
+        Dispatcher::connect(request, SIGNAL(accessTokenChanged(QString)),
+                            q, SLOT(_q_onRequestAccessTokenChanged(QString)));
+        Dispatcher::connect(request, SIGNAL(finished()), q, SLOT(_q_onRequestFinished()));
+#ifdef QVIMEO_DEBUG
+        qDebug() << "QVimeo::DispatcherPrivate::startJob" << job.type << job.host << job.path;
+#endif
+        if (job.type == StreamsJob) {
+            qobject_cast<StreamsRequest*>(request)->list(job.path);
+            return;
+        }
+
+        ResourcesRequest *resources = qobject_cast<ResourcesRequest*>(request);
+
+        switch (job.type) {
+        case ListJob:
+            resources->list(job.path, job.map);
+            break;
+        case GetJob:
+            resources->get(job.path);
+            break;
+        case InsertJob:
+            resources->insert(job.path);
+            break;
+        case InsertResourceJob:
+            resources->insert(job.map, job.path);
+            break;
+        case UpdateJob:
+            resources->update(job.path, job.map);
+            break;
+        case DeleteJob:
+            resources->del(job.path);
+            break;
+        default:
+            break;
+        }
+    }
+
+    void _q_startJobs() {
+        Q_Q(Dispatcher);
+
+        startScheduled = false;
+        startJobs();
+        emit q->countChanged();
+    }
+
+    void _q_onRequestAccessTokenChanged(const QString &token) {
+        if (token != accessToken) {
+            Q_Q(Dispatcher);
+            accessToken = token;
+            emit q->accessTokenChanged(token);
+        }
+    }
+
+    void _q_onRequestFinished() {
+        Q_Q(Dispatcher);
+
+        Request *request = qobject_cast<Request*>(q->sender());
+
+        if ((!request) || (!activeRequests.contains(request))) {
+            return;
+        }
+
+        active[activeRequests.take(request)]--;
+        Dispatcher::disconnect(request, 0, q, 0);
+#ifdef QVIMEO_DEBUG
+        qDebug() << "QVimeo::DispatcherPrivate::_q_onRequestFinished" << request->url() << request->status();
+#endif
+        emit q->requestFinished(request);
+        startJobs();
+        emit q->countChanged();
+
+        if ((queue.isEmpty()) && (activeRequests.isEmpty())) {
+            emit q->finished();
+        }
+    }
+
+    void _q_onRequestDestroyed(QObject *obj) {
+        Q_Q(Dispatcher);
+
+        // The request is no longer a Request, so only its address is used
+        Request *request = static_cast<Request*>(obj);
+
+        if (activeRequests.contains(request)) {
+            active[activeRequests.take(request)]--;
+        }
+
+        for (int i = queue.size() - 1; i >= 0; i--) {
+            if (!queue.at(i).request) {
+                queue.removeAt(i);
+            }
+        }
+#ifdef QVIMEO_DEBUG
+        qDebug() << "QVimeo::DispatcherPrivate::_q_onRequestDestroyed" << obj;
+#endif
+        startJobs();
+        emit q->countChanged();
+
+        if ((queue.isEmpty()) && (activeRequests.isEmpty())) {
+            emit q->finished();
+        }
+    }
+
+    void cancelJob(const Job &job) {
+        Q_Q(Dispatcher);
+
+        Request *request = job.request;
+
+        if (!request) {
+            return;
+        }
+
+        // The request was never started, so it is finished here rather than by Request::cancel()
+        Dispatcher::disconnect(request, 0, q, 0);
+        request->d_func()->setCanceled();
+#ifdef QVIMEO_DEBUG
+        qDebug() << "QVimeo::DispatcherPrivate::cancelJob" << job.type << job.host << job.path;
+#endif
+        emit request->finished();
+        emit q->requestFinished(request);
+    }
+
+    Dispatcher *q_ptr;
+
+    QNetworkAccessManager *manager;
+
+    QString clientId;
+    QString clientSecret;
+    QString accessToken;
+
+    int maximumRequestsPerHost;
+    int maximumStreamsPerHost;
+
+    int timeout;
+    int readTimeout;
+
+    RetryPolicy retryPolicy;
+
+    QList<Job> queue;
+
+    QHash<QString, int> active;
+    QHash<Request*, QString> activeRequests;
+
+    bool starting;
+    bool startScheduled;
+
+    Q_DECLARE_PUBLIC(Dispatcher)
+};
+
+/*!
+    \class Dispatcher
+    \brief Runs many requests to the Vimeo APIs with a limited number in progress at once.
+
+    \ingroup requests
+
+    The Dispatcher creates a request for each job and queues it. At most maximumRequestsPerHost requests to
+    each host are in progress at once, or maximumStreamsPerHost where the host uses HTTP/2, and all requests share the same QNetworkAccessManager (see Network), so
+    that connections are reused. Requests to the Vimeo Data API are also paced according to the RateLimit of
+    the accessToken, so that the limit is not reached. The requestFinished() signal is emitted as each request finishes, and finished()
+    once all jobs are done.
+
+    The requests are children of the Dispatcher. Delete each one (using QObject::deleteLater()) once its
+    result has been read, or they are deleted with the Dispatcher.
+
+    Example usage:
+
+    \code
+    using namespace QVimeo;
+
+    ...
+
+    Dispatcher *dispatcher = new Dispatcher(this);
+    dispatcher->setAccessToken(token);
+    connect(dispatcher, SIGNAL(requestFinished(QVimeo::Request*)), this, SLOT(onRequestFinished(QVimeo::Request*)));
+
+    foreach (const QString &id, videoIds) {
+        dispatcher->get("/videos/" + id);
+    }
+
+    ...
+
+    void MyClass::onRequestFinished(QVimeo::Request *request) {
+        if (request->status() == QVimeo::Request::Ready) {
+            qDebug() << request->result();
+        }
+
+        request->deleteLater();
+    }
+    \endcode
+*/
+Dispatcher::Dispatcher(QObject *parent) :
+    QObject(parent),
+    d_ptr(new DispatcherPrivate(this))
+{
+}
+
+Dispatcher::~Dispatcher() {}
+
+/*!
+    \property QString Dispatcher::clientId
+    \brief The client id to be used by each request.
+
+    \sa Request::clientId
+*/
+
+/*!
+    \fn void Dispatcher::clientIdChanged()
+    \brief Emitted when the clientId changes.
+*/
+QString Dispatcher::clientId() const {
+    Q_D(const Dispatcher);
+
+    return d->clientId;
+}
+
+void Dispatcher::setClientId(const QString &id) {
+    Q_D(Dispatcher);
+
+    if (id != d->clientId) {
+        d->clientId = id;
+        emit clientIdChanged();
+    }
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::Dispatcher::setClientId" << id;
+#endif
+}
+
+/*!
+    \property QString Dispatcher::clientSecret
+    \brief The client secret to be used by each request.
+
+    \sa Request::clientSecret
+*/
+
+/*!
+    \fn void Dispatcher::clientSecretChanged()
+    \brief Emitted when the clientSecret changes.
+*/
+QString Dispatcher::clientSecret() const {
+    Q_D(const Dispatcher);
+
+    return d->clientSecret;
+}
+
+void Dispatcher::setClientSecret(const QString &secret) {
+    Q_D(Dispatcher);
+
+    if (secret != d->clientSecret) {
+        d->clientSecret = secret;
+        emit clientSecretChanged();
+    }
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::Dispatcher::setClientSecret" << secret;
+#endif
+}
+
+/*!
+    \property QString Dispatcher::accessToken
+    \brief The access token to be used by each request.
+
+    If a request refreshes the access token, the new token is used by the requests that start afterwards.
+
+    \sa Request::accessToken
+*/
+
+/*!
+    \fn void Dispatcher::accessTokenChanged()
+    \brief Emitted when the accessToken changes.
+*/
+QString Dispatcher::accessToken() const {
+    Q_D(const Dispatcher);
+
+    return d->accessToken;
+}
+
+void Dispatcher::setAccessToken(const QString &token) {
+    Q_D(Dispatcher);
+
+    if (token != d->accessToken) {
+        d->accessToken = token;
+        emit accessTokenChanged(token);
+    }
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::Dispatcher::setAccessToken" << token;
+#endif
+}
+
+/*!
+    \property int Dispatcher::maximumRequestsPerHost
+    \brief The maximum number of requests to each host that are in progress at once.
+
+    The default is 6. This limit does not apply to hosts that use HTTP/2.
+
+    \sa maximumStreamsPerHost
+*/
+
+/*!
+    \fn void Dispatcher::maximumRequestsPerHostChanged()
+    \brief Emitted when the maximumRequestsPerHost changes.
+*/
+int Dispatcher::maximumRequestsPerHost() const {
+    Q_D(const Dispatcher);
+
+    return d->maximumRequestsPerHost;
+}
+
+void Dispatcher::setMaximumRequestsPerHost(int maximum) {
+    Q_D(Dispatcher);
+
+    maximum = qMax(1, maximum);
+
+    if (maximum != d->maximumRequestsPerHost) {
+        d->maximumRequestsPerHost = maximum;
+        emit maximumRequestsPerHostChanged();
+        d->startJobs();
+        emit countChanged();
+    }
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::Dispatcher::setMaximumRequestsPerHost" << maximum;
+#endif
+}
+
+/*!
+    \property int Dispatcher::maximumStreamsPerHost
+    \brief The maximum number of requests that are in progress at once to each host that uses HTTP/2.
+
+    Requests to these hosts are multiplexed over a single connection, so many more can be in progress at once 
+    without waiting for each other. The default is 100.
+
+    \sa maximumRequestsPerHost, Network::isMultiplexed()
+*/
+
+/*!
+    \fn void Dispatcher::maximumStreamsPerHostChanged()
+    \brief Emitted when the maximumStreamsPerHost changes.
+*/
+int Dispatcher::maximumStreamsPerHost() const {
+    Q_D(const Dispatcher);
+
+    return d->maximumStreamsPerHost;
+}
+
+void Dispatcher::setMaximumStreamsPerHost(int maximum) {
+    Q_D(Dispatcher);
+
+    maximum = qMax(1, maximum);
+
+    if (maximum != d->maximumStreamsPerHost) {
+        d->maximumStreamsPerHost = maximum;
+        emit maximumStreamsPerHostChanged();
+        d->startJobs();
+        emit countChanged();
+    }
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::Dispatcher::setMaximumStreamsPerHost" << maximum;
+#endif
+}
+
+/*!
+    \property int Dispatcher::timeout
+    \brief The maximum time in milliseconds that each request may take once it has started.
+
+    The default is 0, meaning no timeout.
+
+    \sa Request::timeout
+*/
+
+/*!
+    \fn void Dispatcher::timeoutChanged()
+    \brief Emitted when the timeout changes.
+*/
+int Dispatcher::timeout() const {
+    Q_D(const Dispatcher);
+
+    return d->timeout;
+}
+
+void Dispatcher::setTimeout(int msecs) {
+    Q_D(Dispatcher);
+
+    msecs = qMax(0, msecs);
+
+    if (msecs != d->timeout) {
+        d->timeout = msecs;
+        emit timeoutChanged();
+    }
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::Dispatcher::setTimeout" << msecs;
+#endif
+}
+
+/*!
+    \property int Dispatcher::readTimeout
+    \brief The maximum time in milliseconds that each request waits for data from the server.
+
+    The default is 0, meaning no timeout.
+
+    \sa Request::readTimeout
+*/
+
+/*!
+    \fn void Dispatcher::readTimeoutChanged()
+    \brief Emitted when the readTimeout changes.
+*/
+int Dispatcher::readTimeout() const {
+    Q_D(const Dispatcher);
+
+    return d->readTimeout;
+}
+
+void Dispatcher::setReadTimeout(int msecs) {
+    Q_D(Dispatcher);
+
+    msecs = qMax(0, msecs);
+
+    if (msecs != d->readTimeout) {
+        d->readTimeout = msecs;
+        emit readTimeoutChanged();
+    }
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::Dispatcher::setReadTimeout" << msecs;
+#endif
+}
+
+/*!
+    \brief Returns the policy that determines whether and when failed requests are retried.
+
+    \sa setRetryPolicy()
+*/
+RetryPolicy Dispatcher::retryPolicy() const {
+    Q_D(const Dispatcher);
+
+    return d->retryPolicy;
+}
+
+/*!
+    \brief Sets the policy that determines whether and when failed requests are retried to \a policy.
+
+    The policy is applied to requests as they are started. A request that is waiting to be retried still 
+    counts towards the maximumRequestsPerHost.
+
+    \sa Request::setRetryPolicy()
+*/
+void Dispatcher::setRetryPolicy(const RetryPolicy &policy) {
+    Q_D(Dispatcher);
+
+    d->retryPolicy = policy;
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::Dispatcher::setRetryPolicy" << policy.maximumRetries();
+#endif
+}
+
+/*!
+    \property int Dispatcher::activeCount
+    \brief The number of requests in progress.
+*/
+
+/*!
+    \fn void Dispatcher::countChanged()
+    \brief Emitted when the activeCount or pendingCount changes.
+*/
+int Dispatcher::activeCount() const {
+    Q_D(const Dispatcher);
+
+    return d->activeRequests.size();
+}
+
+/*!
+    \property int Dispatcher::pendingCount
+    \brief The number of requests waiting to be started.
+*/
+int Dispatcher::pendingCount() const {
+    Q_D(const Dispatcher);
+
+    return d->queue.size();
+}
+
+/*!
+    \brief Sets the QNetworkAccessManager instance to be used by each request.
+
+    Dispatcher does not take ownership of \a manager.
+
+    If no QNetworkAccessManager is set, the one returned by Network::networkAccessManager() is used.
+*/
+void Dispatcher::setNetworkAccessManager(QNetworkAccessManager *manager) {
+    Q_D(Dispatcher);
+
+    d->manager = manager;
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::Dispatcher::setNetworkAccessManager" << manager;
+#endif
+}
+
+/*!
+    \brief Queues a request for a list of Vimeo resources belonging to \a resourcePath.
+
+    \sa ResourcesRequest::list()
+*/
+ResourcesRequest* Dispatcher::list(const QString &resourcePath, const QVariantMap &filters) {
+    Q_D(Dispatcher);
+
+    return d->addResourcesJob(DispatcherPrivate::ListJob, resourcePath, filters);
+}
+
+/*!
+    \brief Queues a request for the Vimeo resource at \a resourcePath.
+
+    \sa ResourcesRequest::get()
+*/
+ResourcesRequest* Dispatcher::get(const QString &resourcePath) {
+    Q_D(Dispatcher);
+
+    return d->addResourcesJob(DispatcherPrivate::GetJob, resourcePath);
+}
+
+/*!
+    \brief Queues a request to insert a Vimeo resource into \a resourcePath.
+
+    \sa ResourcesRequest::insert()
+*/
+ResourcesRequest* Dispatcher::insert(const QString &resourcePath) {
+    Q_D(Dispatcher);
+
+    return d->addResourcesJob(DispatcherPrivate::InsertJob, resourcePath);
+}
+
+/*!
+    \brief Queues a request to insert a new Vimeo resource.
+
+    \sa ResourcesRequest::insert()
+*/
+ResourcesRequest* Dispatcher::insert(const QVariantMap &resource, const QString &resourcePath) {
+    Q_D(Dispatcher);
+
+    return d->addResourcesJob(DispatcherPrivate::InsertResourceJob, resourcePath, resource);
+}
+
+/*!
+    \brief Queues a request to update the Vimeo resource at \a resourcePath.
+
+    \sa ResourcesRequest::update()
+*/
+ResourcesRequest* Dispatcher::update(const QString &resourcePath, const QVariantMap &resource) {
+    Q_D(Dispatcher);
+
+    return d->addResourcesJob(DispatcherPrivate::UpdateJob, resourcePath, resource);
+}
+
+/*!
+    \brief Queues a request to delete the Vimeo resource at \a resourcePath.
+
+    \sa ResourcesRequest::del()
+*/
+ResourcesRequest* Dispatcher::del(const QString &resourcePath) {
+    Q_D(Dispatcher);
+
+    return d->addResourcesJob(DispatcherPrivate::DeleteJob, resourcePath);
+}
+
+/*!
+    \brief Queues a request for the streams of the video with \a id.
+
+    \sa StreamsRequest::list()
+*/
+StreamsRequest* Dispatcher::streams(const QString &id) {
+    Q_D(Dispatcher);
+
+    DispatcherPrivate::Job job;
+    job.type = DispatcherPrivate::StreamsJob;
+    job.request = new StreamsRequest(this);
+    job.host = QUrl(VIDEO_PAGE_URL).host();
+    job.path = id;
+    d->enqueue(job);
+
+    return qobject_cast<StreamsRequest*>(job.request);
+}
+
+/*!
+    \brief Cancels all requests.
+
+    All requests finish with the Canceled status, including those that have not been started, and 
+    requestFinished() is emitted for each one. They are not deleted.
+*/
+void Dispatcher::cancel() {
+    Q_D(Dispatcher);
+
+    // Requests may be deleted by the receivers of requestFinished(), so the queue is emptied first
+    const QList<DispatcherPrivate::Job> jobs = d->queue;
+    d->queue.clear();
+    emit countChanged();
+
+    foreach (const DispatcherPrivate::Job &job, jobs) {
+        d->cancelJob(job);
+    }
+
+    if (d->activeRequests.isEmpty()) {
+        if (!jobs.isEmpty()) {
+            emit finished();
+        }
+
+        return;
+    }
+
+    // Canceled requests may finish immediately, so the active requests are copied first.
+    // finished() is emitted when the last one finishes.
+    foreach (Request *request, d->activeRequests.keys()) {
+        if (d->activeRequests.contains(request)) {
+            request->cancel();
+        }
+    }
+}
+
+}
+
+#include "moc_dispatcher.cpp"
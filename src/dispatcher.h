@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QVIMEO_DISPATCHER_H
+#define QVIMEO_DISPATCHER_H
+
+#include "resourcesrequest.h"
+#include "streamsrequest.h"
+
+namespace QVimeo {
+
+class DispatcherPrivate;
+
+class QVIMEOSHARED_EXPORT Dispatcher : public QObject
+{
+    Q_OBJECT
+
+    Q_PROPERTY(QString clientId READ clientId WRITE setClientId NOTIFY clientIdChanged)
+    Q_PROPERTY(QString clientSecret READ clientSecret WRITE setClientSecret NOTIFY clientSecretChanged)
+    Q_PROPERTY(QString accessToken READ accessToken WRITE setAccessToken NOTIFY accessTokenChanged)
+    Q_PROPERTY(int maximumRequestsPerHost READ maximumRequestsPerHost WRITE setMaximumRequestsPerHost
+               NOTIFY maximumRequestsPerHostChanged)
+    Q_PROPERTY(int maximumStreamsPerHost READ maximumStreamsPerHost WRITE setMaximumStreamsPerHost
+               NOTIFY maximumStreamsPerHostChanged)
+    Q_PROPERTY(int timeout READ timeout WRITE setTimeout NOTIFY timeoutChanged)
+    Q_PROPERTY(int readTimeout READ readTimeout WRITE setReadTimeout NOTIFY readTimeoutChanged)
+    Q_PROPERTY(int activeCount READ activeCount NOTIFY countChanged)
+    Q_PROPERTY(int pendingCount READ pendingCount NOTIFY countChanged)
+
+public:
+    explicit Dispatcher(QObject *parent = 0);
+    ~Dispatcher();
+
+    QString clientId() const;
+    void setClientId(const QString &id);
+
+    QString clientSecret() const;
+    void setClientSecret(const QString &secret);
+
+    QString accessToken() const;
+    void setAccessToken(const QString &token);
+
+    int maximumRequestsPerHost() const;
+    void setMaximumRequestsPerHost(int maximum);
+
+    int maximumStreamsPerHost() const;
+    void setMaximumStreamsPerHost(int maximum);
+
+    int timeout() const;
+    void setTimeout(int msecs);
+
+    int readTimeout() const;
+    void setReadTimeout(int msecs);
+
+    RetryPolicy retryPolicy() const;
+    void setRetryPolicy(const RetryPolicy &policy);
+
+    int activeCount() const;
+    int pendingCount() const;
+
+    void setNetworkAccessManager(QNetworkAccessManager *manager);
+
+    Q_INVOKABLE QVimeo::ResourcesRequest* list(const QString &resourcePath,
+                                               const QVariantMap &filters = QVariantMap());
+
+    Q_INVOKABLE QVimeo::ResourcesRequest* get(const QString &resourcePath);
+
+    Q_INVOKABLE QVimeo::ResourcesRequest* insert(const QString &resourcePath);
+
+    Q_INVOKABLE QVimeo::ResourcesRequest* insert(const QVariantMap &resource, const QString &resourcePath);
+
+    Q_INVOKABLE QVimeo::ResourcesRequest* update(const QString &resourcePath, const QVariantMap &resource);
+
+    Q_INVOKABLE QVimeo::ResourcesRequest* del(const QString &resourcePath);
+
+    Q_INVOKABLE QVimeo::StreamsRequest* streams(const QString &id);
+
+public Q_SLOTS:
+    void cancel();
+
+Q_SIGNALS:
+    void clientIdChanged();
+    void clientSecretChanged();
+    void accessTokenChanged(const QString &token);
+    void maximumRequestsPerHostChanged();
+    void maximumStreamsPerHostChanged();
+    void timeoutChanged();
+    void readTimeoutChanged();
+    void countChanged();
+    void requestFinished(QVimeo::Request *request);
+    void finished();
+
+private:
+    QScopedPointer<DispatcherPrivate> d_ptr;
+
+    Q_DECLARE_PRIVATE(Dispatcher)
+    Q_DISABLE_COPY(Dispatcher)
+
+    Q_PRIVATE_SLOT(d_func(), void _q_onRequestAccessTokenChanged(QString))
+    Q_PRIVATE_SLOT(d_func(), void _q_onRequestFinished())
+    Q_PRIVATE_SLOT(d_func(), void _q_onRequestDestroyed(QObject*))
+    Q_PRIVATE_SLOT(d_func(), void _q_startJobs())
+};
+
+}
+
+#endif // QVIMEO_DISPATCHER_H
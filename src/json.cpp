@@ -31,38 +31,214 @@
  */
 
 #include "json.h"
+#include <QIODevice>
 #include <iostream>
+#include <string.h>
 
 namespace QtJson
 {
 
 
-static QString sanitizeString(QString str)
+/**
+ * Character classes used by the tokenizer
+ */
+enum JsonCharClass
+{
+        JsonCharNone = 0,
+        JsonCharWhitespace = 1,
+        JsonCharNumber = 2,
+        JsonCharStringSpecial = 4
+};
+
+#define NO JsonCharNone
+#define WS JsonCharWhitespace
+#define NM JsonCharNumber
+#define SP JsonCharStringSpecial
+
+/**
+ * The character class of each byte
+ */
+static const unsigned char charClasses[256] =
+{
+        NO, NO, NO, NO, NO, NO, NO, NO, NO, WS, WS, NO, NO, WS, NO, NO,
+        NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO,
+        WS, NO, SP, NO, NO, NO, NO, NO, NO, NO, NO, NM, NO, NM, NM, NO,
+        NM, NM, NM, NM, NM, NM, NM, NM, NM, NM, NO, NO, NO, NO, NO, NO,
+        NO, NO, NO, NO, NO, NM, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO,
+        NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, SP, NO, NO, NO,
+        NO, NO, NO, NO, NO, NM, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO,
+        NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO,
+        NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO,
+        NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO,
+        NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO,
+        NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO,
+        NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO,
+        NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO,
+        NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO,
+        NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO
+};
+
+#undef NO
+#undef WS
+#undef NM
+#undef SP
+
+#define NO JsonTokenNone
+#define CO JsonTokenCurlyOpen
+#define CC JsonTokenCurlyClose
+#define SO JsonTokenSquaredOpen
+#define SC JsonTokenSquaredClose
+#define CL JsonTokenColon
+#define CM JsonTokenComma
+#define ST JsonTokenString
+#define NM JsonTokenNumber
+#define TR JsonTokenTrue
+#define FA JsonTokenFalse
+#define NU JsonTokenNull
+
+/**
+ * The token that may start with each byte
+ *
+ * The literal tokens (true, false and null) are only identified by their
+ * first byte, and must be verified when consumed.
+ */
+static const unsigned char tokenTable[256] =
+{
+        NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO,
+        NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO,
+        NO, NO, ST, NO, NO, NO, NO, NO, NO, NO, NO, NO, CM, NM, NO, NO,
+        NM, NM, NM, NM, NM, NM, NM, NM, NM, NM, CL, NO, NO, NO, NO, NO,
+        NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO,
+        NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, SO, NO, SC, NO, NO,
+        NO, NO, NO, NO, NO, NO, FA, NO, NO, NO, NO, NO, NO, NO, NU, NO,
+        NO, NO, NO, NO, TR, NO, NO, NO, NO, NO, NO, CO, NO, CC, NO, NO,
+        NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO,
+        NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO,
+        NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO,
+        NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO,
+        NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO,
+        NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO,
+        NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO,
+        NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO, NO
+};
+
+#undef NO
+#undef CO
+#undef CC
+#undef SO
+#undef SC
+#undef CL
+#undef CM
+#undef ST
+#undef NM
+#undef TR
+#undef FA
+#undef NU
+
+static inline bool isCharClass(char c, int charClass)
+{
+        return charClasses[static_cast<unsigned char>(c)] & charClass;
+}
+
+/**
+ * Split a JSON Pointer into its reference tokens
+ *
+ * \return false if the pointer is not valid
+ */
+static bool splitPointer(const QString &pointer, QStringList &tokens)
+{
+        if(pointer.isEmpty())
+        {
+                return true;
+        }
+
+        if(!pointer.startsWith(QChar('/')))
+        {
+                return false;
+        }
+
+        tokens = pointer.mid(1).split(QChar('/'));
+
+        for(int i = 0; i < tokens.size(); i++)
+        {
+                if(tokens.at(i).contains(QChar('~')))
+                {
+                        tokens[i].replace(QLatin1String("~1"), QLatin1String("/"));
+                        tokens[i].replace(QLatin1String("~0"), QLatin1String("~"));
+                }
+        }
+
+        return true;
+}
+
+/**
+ * Convert a JSON Pointer reference token to an array index
+ *
+ * \return The index, or -1 if the token is not an array index
+ */
+static int pointerIndex(const QString &token)
 {
-        str.replace(QLatin1String("\\"), QLatin1String("\\\\"));
-        str.replace(QLatin1String("\""), QLatin1String("\\\""));
-        str.replace(QLatin1String("\b"), QLatin1String("\\b"));
-        str.replace(QLatin1String("\f"), QLatin1String("\\f"));
-        str.replace(QLatin1String("\n"), QLatin1String("\\n"));
-        str.replace(QLatin1String("\r"), QLatin1String("\\r"));
-        str.replace(QLatin1String("\t"), QLatin1String("\\t"));
-        return QString(QLatin1String("\"%1\"")).arg(str);
+        if((token.isEmpty()) || ((token.size() > 1) && (token.at(0) == QChar('0'))))
+        {
+                return -1;
+        }
+
+        for(int i = 0; i < token.size(); i++)
+        {
+                if((token.at(i) < QChar('0')) || (token.at(i) > QChar('9')))
+                {
+                        return -1;
+                }
+        }
+
+        bool ok;
+        const int i = token.toInt(&ok);
+        return ok ? i : -1;
 }
 
-static QByteArray join(const QList<QByteArray> &list, const QByteArray &sep)
+/**
+ * Skip the string starting at index, without decoding it
+ *
+ * On success, index is left after the closing quote.
+ */
+static bool scanString(const char *json, int length, int &index, bool &escaped)
 {
-        QByteArray res;
-        Q_FOREACH(const QByteArray &i, list)
+        //Skip the opening quote
+        index++;
+        escaped = false;
+
+        while(index < length)
         {
-                if(!res.isEmpty())
+                while((index < length) && (!isCharClass(json[index], JsonCharStringSpecial)))
+                {
+                        index++;
+                }
+
+                if((index < length) && (json[index] == '\\'))
+                {
+                        escaped = true;
+                        index += 2;
+                }
+                else
                 {
-                        res += sep;
+                        break;
                 }
-                res += i;
         }
-        return res;
+
+        if(index >= length)
+        {
+                return false;
+        }
+
+        index++;
+        return true;
 }
 
+/**
+ * The size at which serialized data is written to a device
+ */
+static const int WRITE_CHUNK_SIZE = 16384;
+
 /**
  * parse
  */
@@ -82,15 +258,8 @@ QVariant Json::parse(const QString &json, bool &success)
         //Return an empty QVariant if the JSON data is either null or empty
         if(!json.isNull() || !json.isEmpty())
         {
-                QString data = json;
-                //We'll start from index 0
-                int index = 0;
-
-                //Parse the first value
-                QVariant value = Json::parseValue(data, index, success);
-
-                //Return the parsed value
-                return value;
+                //Parse the UTF-8 representation of the data
+                return Json::parse(json.toUtf8(), success);
         }
         else
         {
@@ -99,6 +268,169 @@ QVariant Json::parse(const QString &json, bool &success)
         }
 }
 
+/**
+ * parse
+ */
+QVariant Json::parse(const QByteArray &json)
+{
+        bool success = true;
+        return Json::parse(json, success);
+}
+
+/**
+ * parse
+ */
+QVariant Json::parse(const QByteArray &json, bool &success)
+{
+        return Json::parse(json.constData(), json.size(), success);
+}
+
+/**
+ * parse
+ */
+QVariant Json::parse(const char *json, int length, bool &success)
+{
+        success = true;
+
+        //Return an empty QVariant if the JSON data is null
+        if(!json)
+        {
+                return QVariant();
+        }
+
+        //Build the value from the parser events
+        JsonVariantBuilder builder;
+        success = Json::parse(json, length, &builder);
+        return success ? builder.result() : QVariant();
+}
+
+/**
+ * parse
+ */
+bool Json::parse(const QByteArray &json, JsonHandler *handler)
+{
+        return Json::parse(json.constData(), json.size(), handler);
+}
+
+/**
+ * parse
+ */
+QVariant Json::parse(const QByteArray &json, const JsonProjection &projection, bool &success)
+{
+        JsonVariantBuilder builder;
+        success = Json::parse(json.constData(), json.size(), projection, &builder);
+        return success ? builder.result() : QVariant();
+}
+
+/**
+ * parse
+ */
+bool Json::parse(const char *json, int length, const JsonProjection &projection, JsonHandler *handler)
+{
+        if(projection.isEmpty())
+        {
+                return Json::parse(json, length, handler);
+        }
+
+        if((!json) || (!handler))
+        {
+                return false;
+        }
+
+        int index = 0;
+
+        return Json::parseProjectedValue(json, length, index, projection, 0, handler);
+}
+
+/**
+ * parseDocument
+ */
+JsonDocument Json::parseDocument(const QByteArray &json, bool &success)
+{
+        JsonDocument document;
+        document.d = new JsonDocumentData;
+        int index = 0;
+
+        success = Json::parseDocumentValue(json.constData(), json.size(), index, document.d->nodes);
+
+        if(!success)
+        {
+                return JsonDocument();
+        }
+
+        //Strings refer to the source data, so it is kept with the nodes
+        document.d->json = json;
+        return document;
+}
+
+/**
+ * pointerValue
+ */
+QVariant Json::pointerValue(const QVariant &data, const QString &pointer)
+{
+        QStringList tokens;
+
+        if(!splitPointer(pointer, tokens))
+        {
+                return QVariant();
+        }
+
+        QVariant value = data;
+
+        foreach(const QString &token, tokens)
+        {
+                switch(value.type())
+                {
+                        case QVariant::Map:
+                        {
+                                const QVariantMap map = value.toMap();
+
+                                if(!map.contains(token))
+                                {
+                                        return QVariant();
+                                }
+
+                                value = map.value(token);
+                                break;
+                        }
+                        case QVariant::List:
+                        {
+                                const QVariantList list = value.toList();
+                                const int i = pointerIndex(token);
+
+                                if((i < 0) || (i >= list.size()))
+                                {
+                                        return QVariant();
+                                }
+
+                                value = list.at(i);
+                                break;
+                        }
+                        default:
+                                return QVariant();
+                }
+        }
+
+        return value;
+}
+
+/**
+ * parse
+ */
+bool Json::parse(const char *json, int length, JsonHandler *handler)
+{
+        if((!json) || (!handler))
+        {
+                return false;
+        }
+
+        //We'll start from index 0
+        int index = 0;
+
+        //Parse the first value
+        return Json::parseValue(json, length, index, handler);
+}
+
 QByteArray Json::serialize(const QVariant &data)
 {
         bool success = true;
@@ -107,338 +439,806 @@ QByteArray Json::serialize(const QVariant &data)
 
 QByteArray Json::serialize(const QVariant &data, bool &success)
 {
+        //The whole value is written to a single buffer
         QByteArray str;
-        success = true;
+        str.reserve(1024);
+        success = Json::writeValue(data, str, 0);
+
+        if (success)
+        {
+                return str;
+        }
+        else
+        {
+                return QByteArray();
+        }
+}
+
+bool Json::serialize(const QVariant &data, QIODevice *device)
+{
+        if(!device)
+        {
+                return false;
+        }
+
+        QByteArray str;
+        str.reserve(WRITE_CHUNK_SIZE);
+
+        if(!Json::writeValue(data, str, device))
+        {
+                return false;
+        }
 
+        return (str.isEmpty()) || (device->write(str) == str.size());
+}
+
+/**
+ * writeValue
+ */
+bool Json::writeValue(const QVariant &data, QByteArray &str, QIODevice *device)
+{
         if(!data.isValid()) // invalid or null?
         {
-                str = "null";
+                str.append("null");
         }
         else if((data.type() == QVariant::List) || (data.type() == QVariant::StringList)) // variant is a list?
         {
-                QList<QByteArray> values;
                 const QVariantList list = data.toList();
-                Q_FOREACH(const QVariant& v, list)
+                str.append('[');
+
+                for(int i = 0; i < list.size(); i++)
                 {
-                        QByteArray serializedValue = serialize(v);
-                        if(serializedValue.isNull())
+                        if(i > 0)
                         {
-                                success = false;
-                                break;
+                                str.append(',');
+                        }
+
+                        if(!Json::writeValue(list.at(i), str, device))
+                        {
+                                return false;
                         }
-                        values << serializedValue;
                 }
 
-                str = "[ " + join( values, ", " ) + " ]";
+                str.append(']');
         }
         else if(data.type() == QVariant::Map) // variant is a map?
         {
                 const QVariantMap vmap = data.toMap();
                 QMapIterator<QString, QVariant> it( vmap );
-                str = "{ ";
-                QList<QByteArray> pairs;
+                bool first = true;
+                str.append('{');
+
                 while(it.hasNext())
                 {
                         it.next();
-                        QByteArray serializedValue = serialize(it.value());
-                        if(serializedValue.isNull())
+
+                        if(!first)
                         {
-                                success = false;
-                                break;
+                                str.append(',');
+                        }
+
+                        first = false;
+                        Json::writeString(it.key(), str);
+                        str.append(':');
+
+                        if(!Json::writeValue(it.value(), str, device))
+                        {
+                                return false;
                         }
-                        pairs << sanitizeString(it.key()).toUtf8() + " : " + serializedValue;
                 }
-                str += join(pairs, ", ");
-                str += " }";
+
+                str.append('}');
         }
         else if((data.type() == QVariant::String) || (data.type() == QVariant::ByteArray)) // a string or a byte array?
         {
-                str = sanitizeString(data.toString()).toUtf8();
+                Json::writeString(data.toString(), str);
         }
         else if(data.type() == QVariant::Double) // double?
         {
-                str = QByteArray::number(data.toDouble());
-                if(!str.contains(".") && ! str.contains("e"))
+                const QByteArray number = QByteArray::number(data.toDouble());
+                str.append(number);
+
+                if(!number.contains('.') && !number.contains('e'))
                 {
-                        str += ".0";
+                        str.append(".0");
                 }
         }
         else if (data.type() == QVariant::Bool) // boolean value?
         {
-                str = data.toBool() ? "true" : "false";
+                str.append(data.toBool() ? "true" : "false");
         }
         else if (data.type() == QVariant::ULongLong) // large unsigned number?
         {
-                str = QByteArray::number(data.value<qulonglong>());
+                str.append(QByteArray::number(data.value<qulonglong>()));
         }
         else if ( data.canConvert<qlonglong>() ) // any signed number?
         {
-                str = QByteArray::number(data.value<qlonglong>());
+                str.append(QByteArray::number(data.value<qlonglong>()));
         }
         else if (data.canConvert<long>())
         {
-                str = QString::number(data.value<long>()).toUtf8();
+                str.append(QString::number(data.value<long>()).toUtf8());
         }
         else if (data.canConvert<QString>()) // can value be converted to string?
         {
                 // this will catch QDate, QDateTime, QUrl, ...
-                str = sanitizeString(data.toString()).toUtf8();
+                Json::writeString(data.toString(), str);
         }
         else
         {
-                success = false;
+                return false;
         }
-        if (success)
+
+        //Pass completed data on to the device, so that the buffer stays small
+        if((device) && (str.size() >= WRITE_CHUNK_SIZE))
         {
-                return str;
+                if(device->write(str) != str.size())
+                {
+                        return false;
+                }
+
+                str.truncate(0);
         }
-        else
+
+        return true;
+}
+
+/**
+ * writeString
+ */
+void Json::writeString(const QString &value, QByteArray &str)
+{
+        static const char hexDigits[] = "0123456789abcdef";
+
+        const QByteArray utf8 = value.toUtf8();
+        const char *s = utf8.constData();
+        const int length = utf8.size();
+        int start = 0;
+
+        str.append('\"');
+
+        //Runs of characters that need no escaping are appended in one go
+        for(int i = 0; i < length; i++)
         {
-                return QByteArray();
+                const unsigned char c = static_cast<unsigned char>(s[i]);
+
+                if((c >= 0x20) && (c != '\"') && (c != '\\'))
+                {
+                        continue;
+                }
+
+                str.append(s + start, i - start);
+                start = i + 1;
+
+                switch(c)
+                {
+                        case '\"': str.append("\\\""); break;
+                        case '\\': str.append("\\\\"); break;
+                        case '\b': str.append("\\b"); break;
+                        case '\f': str.append("\\f"); break;
+                        case '\n': str.append("\\n"); break;
+                        case '\r': str.append("\\r"); break;
+                        case '\t': str.append("\\t"); break;
+                        default:
+                                str.append("\\u00");
+                                str.append(hexDigits[c >> 4]);
+                                str.append(hexDigits[c & 0xf]);
+                                break;
+                }
         }
+
+        str.append(s + start, length - start);
+        str.append('\"');
 }
 
 /**
  * parseValue
  */
-QVariant Json::parseValue(const QString &json, int &index, bool &success)
+bool Json::parseValue(const char *json, int length, int &index, JsonHandler *handler)
 {
+        bool success = true;
+
         //Determine what kind of data we should parse by
         //checking out the upcoming token
-        switch(Json::lookAhead(json, index))
+        switch(Json::lookAhead(json, length, index))
         {
                 case JsonTokenString:
-                        return Json::parseString(json, index, success);
+                {
+                        const QVariant value = Json::parseString(json, length, index, success);
+                        return (success) && (handler->value(value));
+                }
                 case JsonTokenNumber:
-                        return Json::parseNumber(json, index);
+                        return handler->value(Json::parseNumber(json, length, index));
                 case JsonTokenCurlyOpen:
-                        return Json::parseObject(json, index, success);
+                        return Json::parseObject(json, length, index, handler);
                 case JsonTokenSquaredOpen:
-                        return Json::parseArray(json, index, success);
+                        return Json::parseArray(json, length, index, handler);
                 case JsonTokenTrue:
-                        Json::nextToken(json, index);
-                        return QVariant(true);
+                        if(Json::nextToken(json, length, index) == JsonTokenTrue)
+                        {
+                                return handler->value(QVariant(true));
+                        }
+                        break;
                 case JsonTokenFalse:
-                        Json::nextToken(json, index);
-                        return QVariant(false);
+                        if(Json::nextToken(json, length, index) == JsonTokenFalse)
+                        {
+                                return handler->value(QVariant(false));
+                        }
+                        break;
                 case JsonTokenNull:
-                        Json::nextToken(json, index);
-                        return QVariant();
-                case JsonTokenNone:
+                        if(Json::nextToken(json, length, index) == JsonTokenNull)
+                        {
+                                return handler->value(QVariant());
+                        }
+                        break;
+                default:
                         break;
         }
 
-        //If there were no tokens, flag the failure and return an empty QVariant
-        success = false;
-        return QVariant();
+        //If there were no tokens, flag the failure
+        return false;
 }
 
 /**
  * parseObject
  */
-QVariant Json::parseObject(const QString &json, int &index, bool &success)
+bool Json::parseObject(const char *json, int length, int &index, JsonHandler *handler)
 {
-        QVariantMap map;
         int token;
 
-        //Get rid of the whitespace and increment index
-        Json::nextToken(json, index);
+        if(!handler->startObject())
+        {
+                return false;
+        }
+
+        //Skip the opening brace
+        index++;
 
         //Loop through all of the key/value pairs of the object
         bool done = false;
         while(!done)
         {
                 //Get the upcoming token
-                token = Json::lookAhead(json, index);
+                token = Json::lookAhead(json, length, index);
 
-                if(token == JsonTokenNone)
+                if(token == JsonTokenComma)
                 {
-                         success = false;
-                         return QVariantMap();
+                        index++;
                 }
-                else if(token == JsonTokenComma)
+                else if(token == JsonTokenCurlyClose)
                 {
-                        Json::nextToken(json, index);
+                        index++;
+                        return handler->endObject();
                 }
-                else if(token == JsonTokenCurlyClose)
-                {
-                        Json::nextToken(json, index);
-                        return map;
-                }
-                else
+                else if(token == JsonTokenString)
                 {
                         //Parse the key/value pair's name
-                        QString name = Json::parseString(json, index, success).toString();
+                        bool success = true;
+                        QString name = Json::parseString(json, length, index, success).toString();
 
-                        if(!success)
+                        if((!success) || (!handler->key(name)))
                         {
-                                return QVariantMap();
+                                return false;
                         }
 
-                        //Get the next token
-                        token = Json::nextToken(json, index);
-
                         //If the next token is not a colon, flag the failure
-                        //return an empty QVariant
-                        if(token != JsonTokenColon)
+                        if(Json::lookAhead(json, length, index) != JsonTokenColon)
                         {
-                                success = false;
-                                return QVariant(QVariantMap());
+                                return false;
                         }
 
-                        //Parse the key/value pair's value
-                        QVariant value = Json::parseValue(json, index, success);
+                        index++;
 
-                        if(!success)
+                        //Parse the key/value pair's value
+                        if(!Json::parseValue(json, length, index, handler))
                         {
-                                return QVariantMap();
+                                return false;
                         }
-
-                        //Assign the value to the key in the map
-                        map[name] = value;
+                }
+                else
+                {
+                        return false;
                 }
         }
 
-        //Return the map successfully
-        return QVariant(map);
+        return false;
 }
 
 /**
  * parseArray
  */
-QVariant Json::parseArray(const QString &json, int &index, bool &success)
+bool Json::parseArray(const char *json, int length, int &index, JsonHandler *handler)
 {
-        QVariantList list;
+        if(!handler->startArray())
+        {
+                return false;
+        }
 
-        Json::nextToken(json, index);
+        //Skip the opening bracket
+        index++;
 
         bool done = false;
         while(!done)
         {
-                int token = Json::lookAhead(json, index);
+                int token = Json::lookAhead(json, length, index);
 
                 if(token == JsonTokenNone)
                 {
-                        success = false;
-                        return QVariantList();
+                        return false;
                 }
                 else if(token == JsonTokenComma)
                 {
-                        Json::nextToken(json, index);
+                        index++;
                 }
                 else if(token == JsonTokenSquaredClose)
                 {
-                        Json::nextToken(json, index);
+                        index++;
                         break;
                 }
-                else
+                else if(!Json::parseValue(json, length, index, handler))
                 {
-                        QVariant value = Json::parseValue(json, index, success);
-
-                        if(!success)
-                        {
-                                return QVariantList();
-                        }
-
-                        list.push_back(value);
+                        return false;
                 }
         }
 
-        return QVariant(list);
+        return handler->endArray();
 }
 
 /**
- * parseString
+ * parseDocumentValue
  */
-QVariant Json::parseString(const QString &json, int &index, bool &success)
+bool Json::parseDocumentValue(const char *json, int length, int &index,
+                              QVector<JsonDocumentData::Node> &nodes)
 {
-        QString s;
-        QChar c;
-
-        Json::eatWhitespace(json, index);
+        JsonDocumentData::Node node;
+        node.size = 0;
+        node.end = nodes.size() + 1;
+        node.escaped = false;
+        node.data.integer = 0;
 
-        c = json[index++];
-
-        bool complete = false;
-        while(!complete)
+        switch(Json::lookAhead(json, length, index))
         {
-                if(index == json.size())
+                case JsonTokenString:
                 {
-                        break;
-                }
+                        //Only the location of the string is stored
+                        const int start = index + 1;
 
-                c = json[index++];
+                        if(!scanString(json, length, index, node.escaped))
+                        {
+                                return false;
+                        }
 
-                if(c == '\"')
-                {
-                        complete = true;
+                        node.type = JsonValue::String;
+                        node.size = index - start - 1;
+                        node.data.offset = start;
                         break;
                 }
-                else if(c == '\\')
+                case JsonTokenNumber:
                 {
-                        if(index == json.size())
-                        {
-                                break;
-                        }
+                        const QVariant number = Json::parseNumber(json, length, index);
 
-                        c = json[index++];
-
-                        if(c == '\"')
+                        switch(number.type())
                         {
-                                s.append('\"');
+                                case QVariant::Double:
+                                        node.type = JsonValue::Double;
+                                        node.data.real = number.toDouble();
+                                        break;
+                                case QVariant::ULongLong:
+                                        node.type = JsonValue::UnsignedInteger;
+                                        node.data.unsignedInteger = number.toULongLong();
+                                        break;
+                                default:
+                                        node.type = JsonValue::Integer;
+                                        node.data.integer = number.toLongLong();
+                                        break;
                         }
-                        else if(c == '\\')
+
+                        break;
+                }
+                case JsonTokenTrue:
+                case JsonTokenFalse:
+                case JsonTokenNull:
+                        switch(Json::nextToken(json, length, index))
                         {
-                                s.append('\\');
+                                case JsonTokenTrue:
+                                        node.type = JsonValue::Bool;
+                                        node.data.boolean = true;
+                                        break;
+                                case JsonTokenFalse:
+                                        node.type = JsonValue::Bool;
+                                        node.data.boolean = false;
+                                        break;
+                                case JsonTokenNull:
+                                        node.type = JsonValue::Null;
+                                        break;
+                                default:
+                                        return false;
                         }
-                        else if(c == '/')
+
+                        break;
+                case JsonTokenCurlyOpen:
+                case JsonTokenSquaredOpen:
+                {
+                        //The container is stored ahead of its children, and is
+                        //completed once they have been parsed
+                        const bool object = (json[index] == '{');
+                        const int container = nodes.size();
+                        node.type = object ? JsonValue::Object : JsonValue::Array;
+                        nodes.append(node);
+
+                        //Skip the opening brace or bracket
+                        index++;
+
+                        int count = 0;
+
+                        while(true)
                         {
-                                s.append('/');
+                                const int token = Json::lookAhead(json, length, index);
+
+                                if(token == JsonTokenComma)
+                                {
+                                        index++;
+                                }
+                                else if(token == (object ? JsonTokenCurlyClose : JsonTokenSquaredClose))
+                                {
+                                        index++;
+                                        break;
+                                }
+                                else if(object)
+                                {
+                                        //Parse the key/value pair
+                                        if((token != JsonTokenString) ||
+                                           (!Json::parseDocumentValue(json, length, index, nodes)) ||
+                                           (Json::lookAhead(json, length, index) != JsonTokenColon))
+                                        {
+                                                return false;
+                                        }
+
+                                        index++;
+
+                                        if(!Json::parseDocumentValue(json, length, index, nodes))
+                                        {
+                                                return false;
+                                        }
+
+                                        count++;
+                                }
+                                else if((token == JsonTokenNone) ||
+                                        (!Json::parseDocumentValue(json, length, index, nodes)))
+                                {
+                                        return false;
+                                }
+                                else
+                                {
+                                        count++;
+                                }
                         }
-                        else if(c == 'b')
+
+                        nodes[container].size = count;
+                        nodes[container].end = nodes.size();
+                        return true;
+                }
+                default:
+                        return false;
+        }
+
+        nodes.append(node);
+        return true;
+}
+
+/**
+ * parseProjectedValue
+ */
+bool Json::parseProjectedValue(const char *json, int length, int &index,
+                               const JsonProjection &projection, int node,
+                               JsonHandler *handler)
+{
+        if(projection.includesAll(node))
+        {
+                return Json::parseValue(json, length, index, handler);
+        }
+
+        switch(Json::lookAhead(json, length, index))
+        {
+                case JsonTokenCurlyOpen:
+                        return Json::parseProjectedObject(json, length, index, projection, node, handler);
+                case JsonTokenSquaredOpen:
+                        return Json::parseProjectedArray(json, length, index, projection, node, handler);
+                default:
+                        //A scalar cannot contain the projected keys
+                        return Json::skipValue(json, length, index);
+        }
+}
+
+/**
+ * parseProjectedObject
+ */
+bool Json::parseProjectedObject(const char *json, int length, int &index,
+                                const JsonProjection &projection, int node,
+                                JsonHandler *handler)
+{
+        if(!handler->startObject())
+        {
+                return false;
+        }
+
+        //Skip the opening brace
+        index++;
+
+        while(true)
+        {
+                int token = Json::lookAhead(json, length, index);
+
+                if(token == JsonTokenComma)
+                {
+                        index++;
+                }
+                else if(token == JsonTokenCurlyClose)
+                {
+                        index++;
+                        return handler->endObject();
+                }
+                else if(token == JsonTokenString)
+                {
+                        bool success = true;
+                        QString name = Json::parseString(json, length, index, success).toString();
+
+                        if((!success) || (Json::lookAhead(json, length, index) != JsonTokenColon))
                         {
-                                s.append('\b');
+                                return false;
                         }
-                        else if(c == 'f')
+
+                        index++;
+
+                        const int child = projection.child(node, name);
+
+                        if(child < 0)
                         {
-                                s.append('\f');
+                                if(!Json::skipValue(json, length, index))
+                                {
+                                        return false;
+                                }
+
+                                continue;
                         }
-                        else if(c == 'n')
+
+                        //Only containers can hold the keys below a partially projected key
+                        token = Json::lookAhead(json, length, index);
+
+                        if((!projection.includesAll(child)) && (token != JsonTokenCurlyOpen) &&
+                           (token != JsonTokenSquaredOpen))
                         {
-                                s.append('\n');
+                                if(!Json::skipValue(json, length, index))
+                                {
+                                        return false;
+                                }
+
+                                continue;
                         }
-                        else if(c == 'r')
+
+                        if((!handler->key(name)) ||
+                           (!Json::parseProjectedValue(json, length, index, projection, child, handler)))
                         {
-                                s.append('\r');
+                                return false;
                         }
-                        else if(c == 't')
+                }
+                else
+                {
+                        return false;
+                }
+        }
+}
+
+/**
+ * parseProjectedArray
+ */
+bool Json::parseProjectedArray(const char *json, int length, int &index,
+                               const JsonProjection &projection, int node,
+                               JsonHandler *handler)
+{
+        if(!handler->startArray())
+        {
+                return false;
+        }
+
+        //Skip the opening bracket
+        index++;
+
+        while(true)
+        {
+                int token = Json::lookAhead(json, length, index);
+
+                if(token == JsonTokenNone)
+                {
+                        return false;
+                }
+                else if(token == JsonTokenComma)
+                {
+                        index++;
+                }
+                else if(token == JsonTokenSquaredClose)
+                {
+                        index++;
+                        return handler->endArray();
+                }
+                else if(!Json::parseProjectedValue(json, length, index, projection, node, handler))
+                {
+                        return false;
+                }
+        }
+}
+
+/**
+ * skipValue
+ */
+bool Json::skipValue(const char *json, int length, int &index)
+{
+        //The closing characters of the containers being skipped
+        QByteArray closers;
+
+        do
+        {
+                switch(Json::lookAhead(json, length, index))
+                {
+                        case JsonTokenString:
                         {
-                                s.append('\t');
+                                bool escaped;
+
+                                if(!scanString(json, length, index, escaped))
+                                {
+                                        return false;
+                                }
+
+                                break;
                         }
-                        else if(c == 'u')
-                        {
-                                int remainingLength = json.size() - index;
+                        case JsonTokenNumber:
+                                index = Json::lastIndexOfNumber(json, length, index) + 1;
+                                break;
+                        case JsonTokenTrue:
+                        case JsonTokenFalse:
+                        case JsonTokenNull:
+                                if(Json::nextToken(json, length, index) == JsonTokenNone)
+                                {
+                                        return false;
+                                }
+                                break;
+                        case JsonTokenCurlyOpen:
+                                closers.append('}');
+                                index++;
+                                break;
+                        case JsonTokenSquaredOpen:
+                                closers.append(']');
+                                index++;
+                                break;
+                        case JsonTokenCurlyClose:
+                        case JsonTokenSquaredClose:
+                                if((closers.isEmpty()) || (json[index] != closers.at(closers.size() - 1)))
+                                {
+                                        return false;
+                                }
 
-                                if(remainingLength >= 4)
+                                closers.chop(1);
+                                index++;
+                                break;
+                        case JsonTokenColon:
+                        case JsonTokenComma:
+                                if(closers.isEmpty())
                                 {
-                                        QString unicodeStr = json.mid(index, 4);
+                                        return false;
+                                }
+
+                                index++;
+                                break;
+                        default:
+                                return false;
+                }
+        }
+        while(!closers.isEmpty());
+
+        return true;
+}
+
+/**
+ * parseString
+ */
+QVariant Json::parseString(const char *json, int length, int &index, bool &success)
+{
+        QString s;
+        char c;
+
+        //Skip the opening quote. The caller has already positioned index
+        //at the start of the token
+        index++;
+
+        //The start of the current run of unescaped bytes. Runs are decoded
+        //from UTF-8 in one go, rather than character by character
+        int start = index;
+        bool escaped = false;
+
+        bool complete = false;
+        while(!complete)
+        {
+                //Skip to the next quote or backslash
+                while((index < length) && (!isCharClass(json[index], JsonCharStringSpecial)))
+                {
+                        index++;
+                }
+
+                if(index == length)
+                {
+                        break;
+                }
+
+                c = json[index++];
+
+                if(c == '\"')
+                {
+                        complete = true;
+                        break;
+                }
+
+                s.append(QString::fromUtf8(json + start, index - start - 1));
+                escaped = true;
 
-                                        int symbol = unicodeStr.toInt(0, 16);
+                if(index == length)
+                {
+                        break;
+                }
 
-                                        s.append(QChar(symbol));
+                c = json[index++];
 
-                                        index += 4;
+                switch(c)
+                {
+                        case '\"': s.append(QChar('\"')); break;
+                        case '\\': s.append(QChar('\\')); break;
+                        case '/': s.append(QChar('/')); break;
+                        case 'b': s.append(QChar('\b')); break;
+                        case 'f': s.append(QChar('\f')); break;
+                        case 'n': s.append(QChar('\n')); break;
+                        case 'r': s.append(QChar('\r')); break;
+                        case 't': s.append(QChar('\t')); break;
+                        case 'u':
+                        {
+                                if(length - index < 4)
+                                {
+                                        success = false;
+                                        return QVariant();
                                 }
-                                else
+
+                                int symbol = 0;
+
+                                for(int i = 0; i < 4; i++)
                                 {
-                                        break;
+                                        c = json[index++];
+                                        symbol <<= 4;
+
+                                        if(c >= '0' && c <= '9')
+                                        {
+                                                symbol |= c - '0';
+                                        }
+                                        else if(c >= 'a' && c <= 'f')
+                                        {
+                                                symbol |= c - 'a' + 10;
+                                        }
+                                        else if(c >= 'A' && c <= 'F')
+                                        {
+                                                symbol |= c - 'A' + 10;
+                                        }
+                                        else
+                                        {
+                                                success = false;
+                                                return QVariant();
+                                        }
                                 }
+
+                                s.append(QChar(symbol));
+                                break;
                         }
+                        default:
+                                break;
                 }
-                else
-                {
-                        s.append(c);
-                }
+
+                start = index;
         }
 
         if(!complete)
@@ -447,27 +1247,64 @@ QVariant Json::parseString(const QString &json, int &index, bool &success)
                 return QVariant();
         }
 
+        //Decode the final run, excluding the closing quote
+        if(!escaped)
+        {
+                return QVariant(QString::fromUtf8(json + start, index - start - 1));
+        }
+
+        s.append(QString::fromUtf8(json + start, index - start - 1));
         return QVariant(s);
 }
 
 /**
  * parseNumber
  */
-QVariant Json::parseNumber(const QString &json, int &index)
+QVariant Json::parseNumber(const char *json, int length, int &index)
 {
-        Json::eatWhitespace(json, index);
-
-        int lastIndex = Json::lastIndexOfNumber(json, index);
+        int lastIndex = Json::lastIndexOfNumber(json, length, index);
         int charLength = (lastIndex - index) + 1;
-        QString numberStr;
-
-        numberStr = json.mid(index, charLength);
+        const char *number = json + index;
 
         index = lastIndex + 1;
 
-        if (numberStr.contains('.')) {
+        //Integers that cannot overflow are converted in place
+        bool negative = (number[0] == '-');
+        int digits = negative ? charLength - 1 : charLength;
+
+        if((digits > 0) && (digits < 19))
+        {
+                qulonglong value = 0;
+                int i = negative ? 1 : 0;
+
+                for(; i < charLength; i++)
+                {
+                        char c = number[i];
+
+                        if(c < '0' || c > '9')
+                        {
+                                break;
+                        }
+
+                        value = value * 10 + (c - '0');
+                }
+
+                if(i == charLength)
+                {
+                        if(negative)
+                        {
+                                return QVariant(-qlonglong(value));
+                        }
+
+                        return QVariant(value);
+                }
+        }
+
+        QByteArray numberStr = QByteArray(number, charLength);
+
+        if (numberStr.contains('.') || numberStr.contains('e') || numberStr.contains('E')) {
                 return QVariant(numberStr.toDouble(NULL));
-        } else if (numberStr.startsWith('-')) {
+        } else if (negative) {
                 return QVariant(numberStr.toLongLong(NULL));
         } else {
                 return QVariant(numberStr.toULongLong(NULL));
@@ -477,13 +1314,13 @@ QVariant Json::parseNumber(const QString &json, int &index)
 /**
  * lastIndexOfNumber
  */
-int Json::lastIndexOfNumber(const QString &json, int index)
+int Json::lastIndexOfNumber(const char *json, int length, int index)
 {
         int lastIndex;
 
-        for(lastIndex = index; lastIndex < json.size(); lastIndex++)
+        for(lastIndex = index; lastIndex < length; lastIndex++)
         {
-                if(QString("0123456789+-.eE").indexOf(json[lastIndex]) == -1)
+                if(!isCharClass(json[lastIndex], JsonCharNumber))
                 {
                         break;
                 }
@@ -495,93 +1332,1299 @@ int Json::lastIndexOfNumber(const QString &json, int index)
 /**
  * eatWhitespace
  */
-void Json::eatWhitespace(const QString &json, int &index)
+void Json::eatWhitespace(const char *json, int length, int &index)
 {
-        for(; index < json.size(); index++)
+        while((index < length) && (isCharClass(json[index], JsonCharWhitespace)))
         {
-                if(QString(" \t\n\r").indexOf(json[index]) == -1)
-                {
-                        break;
-                }
+                index++;
         }
 }
 
 /**
  * lookAhead
  */
-int Json::lookAhead(const QString &json, int index)
+int Json::lookAhead(const char *json, int length, int &index)
 {
-        int saveIndex = index;
-        return Json::nextToken(json, saveIndex);
+        Json::eatWhitespace(json, length, index);
+
+        if(index == length)
+        {
+                return JsonTokenNone;
+        }
+
+        return tokenTable[static_cast<unsigned char>(json[index])];
 }
 
 /**
  * nextToken
  */
-int Json::nextToken(const QString &json, int &index)
+int Json::nextToken(const char *json, int length, int &index)
 {
-        Json::eatWhitespace(json, index);
+        int token = Json::lookAhead(json, length, index);
 
-        if(index == json.size())
+        switch(token)
         {
-                return JsonTokenNone;
+                case JsonTokenNone:
+                        return JsonTokenNone;
+                case JsonTokenTrue:
+                        if((length - index >= 4) && (qstrncmp(json + index, "true", 4) == 0))
+                        {
+                                index += 4;
+                                return JsonTokenTrue;
+                        }
+                        return JsonTokenNone;
+                case JsonTokenFalse:
+                        if((length - index >= 5) && (qstrncmp(json + index, "false", 5) == 0))
+                        {
+                                index += 5;
+                                return JsonTokenFalse;
+                        }
+                        return JsonTokenNone;
+                case JsonTokenNull:
+                        if((length - index >= 4) && (qstrncmp(json + index, "null", 4) == 0))
+                        {
+                                index += 4;
+                                return JsonTokenNull;
+                        }
+                        return JsonTokenNone;
+                default:
+                        index++;
+                        return token;
+        }
+}
+
+
+/**
+ * JsonProjection
+ */
+JsonProjection::JsonProjection()
+{
+        Node root;
+        root.all = true;
+        nodes.append(root);
+}
+
+/**
+ * JsonProjection
+ */
+JsonProjection::JsonProjection(const QStringList &paths) :
+        pathList(paths)
+{
+        Node root;
+        root.all = paths.isEmpty();
+        nodes.append(root);
+
+        foreach(const QString &path, paths)
+        {
+                int node = 0;
+
+                foreach(QString key, path.split('.', QString::SkipEmptyParts))
+                {
+                        //Arrays are transparent, so any subscript is ignored
+                        const int bracket = key.indexOf('[');
+
+                        if(bracket >= 0)
+                        {
+                                key.truncate(bracket);
+                        }
+
+                        if((key.isEmpty()) || (nodes.at(node).all))
+                        {
+                                continue;
+                        }
+
+                        int child = nodes.at(node).children.value(key, -1);
+
+                        if(child < 0)
+                        {
+                                Node n;
+                                n.all = false;
+                                child = nodes.size();
+                                nodes.append(n);
+                                nodes[node].children.insert(key, child);
+                        }
+
+                        node = child;
+                }
+
+                //Everything below the last key is kept
+                nodes[node].all = true;
+                nodes[node].children.clear();
+        }
+}
+
+/**
+ * paths
+ */
+QStringList JsonProjection::paths() const
+{
+        return pathList;
+}
+
+/**
+ * isEmpty
+ */
+bool JsonProjection::isEmpty() const
+{
+        return nodes.first().all;
+}
+
+/**
+ * child
+ */
+int JsonProjection::child(int node, const QString &key) const
+{
+        if(node < 0)
+        {
+                return -1;
+        }
+
+        const Node &n = nodes.at(node);
+        return n.all ? node : n.children.value(key, -1);
+}
+
+/**
+ * includesAll
+ */
+bool JsonProjection::includesAll(int node) const
+{
+        return (node >= 0) && (nodes.at(node).all);
+}
+
+
+/**
+ * JsonValue
+ */
+JsonValue::JsonValue() :
+        index(-1)
+{
+}
+
+/**
+ * JsonValue
+ */
+JsonValue::JsonValue(JsonDocumentData *data, int node) :
+        doc(data),
+        index(node)
+{
+}
+
+/**
+ * type
+ */
+JsonValue::Type JsonValue::type() const
+{
+        if((!doc) || (index < 0) || (index >= doc->nodes.size()))
+        {
+                return Undefined;
+        }
+
+        return doc->nodes.at(index).type;
+}
+
+/**
+ * isUndefined
+ */
+bool JsonValue::isUndefined() const
+{
+        return type() == Undefined;
+}
+
+/**
+ * isNull
+ */
+bool JsonValue::isNull() const
+{
+        return type() == Null;
+}
+
+/**
+ * isBool
+ */
+bool JsonValue::isBool() const
+{
+        return type() == Bool;
+}
+
+/**
+ * isNumber
+ */
+bool JsonValue::isNumber() const
+{
+        const Type t = type();
+        return (t == Integer) || (t == UnsignedInteger) || (t == Double);
+}
+
+/**
+ * isString
+ */
+bool JsonValue::isString() const
+{
+        return type() == String;
+}
+
+/**
+ * isArray
+ */
+bool JsonValue::isArray() const
+{
+        return type() == Array;
+}
+
+/**
+ * isObject
+ */
+bool JsonValue::isObject() const
+{
+        return type() == Object;
+}
+
+/**
+ * toBool
+ */
+bool JsonValue::toBool() const
+{
+        return (type() == Bool) && (doc->nodes.at(index).data.boolean);
+}
+
+/**
+ * toDouble
+ */
+double JsonValue::toDouble() const
+{
+        switch(type())
+        {
+                case Integer:
+                        return double(doc->nodes.at(index).data.integer);
+                case UnsignedInteger:
+                        return double(doc->nodes.at(index).data.unsignedInteger);
+                case Double:
+                        return doc->nodes.at(index).data.real;
+                default:
+                        return 0;
+        }
+}
+
+/**
+ * toLongLong
+ */
+qlonglong JsonValue::toLongLong() const
+{
+        switch(type())
+        {
+                case Integer:
+                        return doc->nodes.at(index).data.integer;
+                case UnsignedInteger:
+                        return qlonglong(doc->nodes.at(index).data.unsignedInteger);
+                case Double:
+                        return qlonglong(doc->nodes.at(index).data.real);
+                default:
+                        return 0;
+        }
+}
+
+/**
+ * toString
+ */
+QString JsonValue::toString() const
+{
+        if(type() != String)
+        {
+                return QString();
+        }
+
+        const JsonDocumentData::Node &node = doc->nodes.at(index);
+        const char *json = doc->json.constData();
+
+        if(!node.escaped)
+        {
+                return QString::fromUtf8(json + node.data.offset, node.size);
+        }
+
+        //Decode the escape sequences, starting from the opening quote
+        bool success = true;
+        int start = node.data.offset - 1;
+        return Json::parseString(json, node.data.offset + node.size + 1, start, success).toString();
+}
+
+/**
+ * size
+ */
+int JsonValue::size() const
+{
+        const Type t = type();
+        return (t == Array) || (t == Object) ? doc->nodes.at(index).size : 0;
+}
+
+/**
+ * at
+ */
+JsonValue JsonValue::at(int i) const
+{
+        if((type() != Array) || (i < 0) || (i >= doc->nodes.at(index).size))
+        {
+                return JsonValue();
+        }
+
+        int node = index + 1;
+
+        while(i > 0)
+        {
+                node = next(node);
+                i--;
+        }
+
+        return JsonValue(doc.data(), node);
+}
+
+/**
+ * value
+ */
+JsonValue JsonValue::value(const QString &key) const
+{
+        if(type() != Object)
+        {
+                return JsonValue();
+        }
+
+        const QByteArray name = key.toUtf8();
+        const char *json = doc->json.constData();
+        const int count = doc->nodes.at(index).size;
+        int node = index + 1;
+        int found = -1;
+
+        for(int i = 0; i < count; i++)
+        {
+                const JsonDocumentData::Node &keyNode = doc->nodes.at(node);
+
+                //Keys without escape sequences are compared in place. As with
+                //Json::parse, the last of any duplicate keys is used
+                if(keyNode.escaped ? (JsonValue(doc.data(), node).toString() == key)
+                                   : ((keyNode.size == name.size()) &&
+                                      (memcmp(json + keyNode.data.offset, name.constData(), name.size()) == 0)))
+                {
+                        found = node + 1;
+                }
+
+                node = next(node + 1);
+        }
+
+        return found >= 0 ? JsonValue(doc.data(), found) : JsonValue();
+}
+
+/**
+ * keys
+ */
+QStringList JsonValue::keys() const
+{
+        QStringList list;
+
+        if(type() == Object)
+        {
+                const int count = doc->nodes.at(index).size;
+                int node = index + 1;
+
+                for(int i = 0; i < count; i++)
+                {
+                        list.append(JsonValue(doc.data(), node).toString());
+                        node = next(node + 1);
+                }
+        }
+
+        return list;
+}
+
+/**
+ * toVariant
+ */
+QVariant JsonValue::toVariant() const
+{
+        switch(type())
+        {
+                case Bool:
+                        return QVariant(doc->nodes.at(index).data.boolean);
+                case Integer:
+                        return QVariant(doc->nodes.at(index).data.integer);
+                case UnsignedInteger:
+                        return QVariant(doc->nodes.at(index).data.unsignedInteger);
+                case Double:
+                        return QVariant(doc->nodes.at(index).data.real);
+                case String:
+                        return QVariant(toString());
+                case Array:
+                {
+                        QVariantList list;
+                        const int count = doc->nodes.at(index).size;
+                        int node = index + 1;
+
+                        for(int i = 0; i < count; i++)
+                        {
+                                list.append(JsonValue(doc.data(), node).toVariant());
+                                node = next(node);
+                        }
+
+                        return QVariant(list);
+                }
+                case Object:
+                {
+                        QVariantMap map;
+                        const int count = doc->nodes.at(index).size;
+                        int node = index + 1;
+
+                        for(int i = 0; i < count; i++)
+                        {
+                                map.insert(JsonValue(doc.data(), node).toString(), JsonValue(doc.data(), node + 1).toVariant());
+                                node = next(node + 1);
+                        }
+
+                        return QVariant(map);
+                }
+                default:
+                        return QVariant();
+        }
+}
+
+/**
+ * next
+ */
+int JsonValue::next(int node) const
+{
+        return doc->nodes.at(node).end;
+}
+
+
+/**
+ * JsonDocument
+ */
+JsonDocument::JsonDocument()
+{
+}
+
+/**
+ * isNull
+ */
+bool JsonDocument::isNull() const
+{
+        return (!d) || (d->nodes.isEmpty());
+}
+
+/**
+ * root
+ */
+JsonValue JsonDocument::root() const
+{
+        return isNull() ? JsonValue() : JsonValue(d.data(), 0);
+}
+
+/**
+ * value
+ */
+JsonValue JsonDocument::value(const QString &pointer) const
+{
+        QStringList tokens;
+
+        if(!splitPointer(pointer, tokens))
+        {
+                return JsonValue();
+        }
+
+        JsonValue v = root();
+
+        foreach(const QString &token, tokens)
+        {
+                if(v.isObject())
+                {
+                        v = v.value(token);
+                }
+                else if(v.isArray())
+                {
+                        v = v.at(pointerIndex(token));
+                }
+                else
+                {
+                        return JsonValue();
+                }
+        }
+
+        return v;
+}
+
+/**
+ * toVariant
+ */
+QVariant JsonDocument::toVariant() const
+{
+        return root().toVariant();
+}
+
+
+/**
+ * JsonHandler
+ */
+JsonHandler::~JsonHandler()
+{
+}
+
+/**
+ * startObject
+ */
+bool JsonHandler::startObject()
+{
+        return true;
+}
+
+/**
+ * key
+ */
+bool JsonHandler::key(const QString &)
+{
+        return true;
+}
+
+/**
+ * endObject
+ */
+bool JsonHandler::endObject()
+{
+        return true;
+}
+
+/**
+ * startArray
+ */
+bool JsonHandler::startArray()
+{
+        return true;
+}
+
+/**
+ * endArray
+ */
+bool JsonHandler::endArray()
+{
+        return true;
+}
+
+/**
+ * value
+ */
+bool JsonHandler::value(const QVariant &)
+{
+        return true;
+}
+
+
+/**
+ * JsonVariantBuilder
+ */
+JsonVariantBuilder::JsonVariantBuilder()
+{
+}
+
+/**
+ * startObject
+ */
+bool JsonVariantBuilder::startObject()
+{
+        Frame frame;
+        frame.object = true;
+        stack.append(frame);
+        return true;
+}
+
+/**
+ * key
+ */
+bool JsonVariantBuilder::key(const QString &name)
+{
+        if(stack.isEmpty())
+        {
+                return false;
+        }
+
+        stack.last().key = name;
+        return true;
+}
+
+/**
+ * endObject
+ */
+bool JsonVariantBuilder::endObject()
+{
+        if(stack.isEmpty())
+        {
+                return false;
+        }
+
+        const QVariant v(stack.last().map);
+        stack.resize(stack.size() - 1);
+        addValue(v);
+        return true;
+}
+
+/**
+ * startArray
+ */
+bool JsonVariantBuilder::startArray()
+{
+        Frame frame;
+        frame.object = false;
+        stack.append(frame);
+        return true;
+}
+
+/**
+ * endArray
+ */
+bool JsonVariantBuilder::endArray()
+{
+        if(stack.isEmpty())
+        {
+                return false;
+        }
+
+        const QVariant v(stack.last().list);
+        stack.resize(stack.size() - 1);
+        addValue(v);
+        return true;
+}
+
+/**
+ * value
+ */
+bool JsonVariantBuilder::value(const QVariant &v)
+{
+        addValue(v);
+        return true;
+}
+
+/**
+ * result
+ */
+QVariant JsonVariantBuilder::result() const
+{
+        return root;
+}
+
+/**
+ * reset
+ */
+void JsonVariantBuilder::reset()
+{
+        stack.clear();
+        root = QVariant();
+        elements.clear();
+}
+
+/**
+ * elementsKey
+ */
+QString JsonVariantBuilder::elementsKey() const
+{
+        return elementKey;
+}
+
+/**
+ * setElementsKey
+ */
+void JsonVariantBuilder::setElementsKey(const QString &key)
+{
+        elementKey = key;
+}
+
+/**
+ * takeElements
+ */
+QVariantList JsonVariantBuilder::takeElements()
+{
+        QVariantList list = elements;
+        elements.clear();
+        return list;
+}
+
+/**
+ * addValue
+ */
+void JsonVariantBuilder::addValue(const QVariant &v)
+{
+        if(stack.isEmpty())
+        {
+                root = v;
+                return;
+        }
+
+        Frame &frame = stack.last();
+
+        if(frame.object)
+        {
+                frame.map.insert(frame.key, v);
+        }
+        else
+        {
+                frame.list.append(v);
+
+                //Collect the elements of the array at elementKey in the top level object
+                if((stack.size() == 2) && (stack.first().object) && (!elementKey.isEmpty()) &&
+                   (stack.first().key == elementKey))
+                {
+                        elements.append(v);
+                }
+        }
+}
+
+
+/**
+ * JsonStreamParser
+ */
+JsonStreamParser::JsonStreamParser() :
+        eventHandler(&builder),
+        state(ExpectValue),
+        tokenStart(-1),
+        valueNode(0),
+        skipToken(false),
+        stringIsKey(false),
+        escape(false),
+        empty(true)
+{
+}
+
+/**
+ * feed
+ */
+bool JsonStreamParser::feed(const QByteArray &data)
+{
+        return feed(data.constData(), data.size());
+}
+
+/**
+ * feed
+ */
+bool JsonStreamParser::feed(const char *data, int length)
+{
+        if(length > 0)
+        {
+                empty = false;
+        }
+
+        int index = 0;
+
+        while((index < length) && (state != Error))
+        {
+                if(state == InString)
+                {
+                        //Skip to the closing quote, stepping over escaped characters
+                        while(index < length)
+                        {
+                                const char c = data[index];
+
+                                if(escape)
+                                {
+                                        escape = false;
+                                }
+                                else if(c == '\\')
+                                {
+                                        escape = true;
+                                }
+                                else if(c == '\"')
+                                {
+                                        break;
+                                }
+
+                                index++;
+                        }
+
+                        if(index == length)
+                        {
+                                //The string continues in the next chunk
+                                const int start = qMax(0, tokenStart);
+                                buffer.append(data + start, length - start);
+                                tokenStart = -1;
+                                return true;
+                        }
+
+                        if(!endString(data, index))
+                        {
+                                state = Error;
+                                return false;
+                        }
+
+                        index++;
+                        continue;
+                }
+
+                if(state == InAtom)
+                {
+                        while((index < length) && ((isCharClass(data[index], JsonCharNumber)) ||
+                                                   ((data[index] >= 'a') && (data[index] <= 'z'))))
+                        {
+                                index++;
+                        }
+
+                        if(index == length)
+                        {
+                                //The number or literal continues in the next chunk
+                                const int start = qMax(0, tokenStart);
+                                buffer.append(data + start, length - start);
+                                tokenStart = -1;
+                                return true;
+                        }
+
+                        //The delimiter is handled on the next iteration
+                        if(!endAtom(data, index))
+                        {
+                                state = Error;
+                                return false;
+                        }
+
+                        continue;
+                }
+
+                const char c = data[index];
+
+                if(isCharClass(c, JsonCharWhitespace))
+                {
+                        index++;
+                        continue;
+                }
+
+                switch(state)
+                {
+                        case ExpectValue:
+                                if(!beginValue(data, length, index))
+                                {
+                                        state = Error;
+                                }
+                                break;
+                        case ExpectFirstValueOrClose:
+                                if(c == ']')
+                                {
+                                        index++;
+
+                                        if(!closeContainer())
+                                        {
+                                                state = Error;
+                                        }
+                                }
+                                else if(!beginValue(data, length, index))
+                                {
+                                        state = Error;
+                                }
+                                break;
+                        case ExpectFirstKeyOrClose:
+                        case ExpectKey:
+                                if((c == '}') && (state == ExpectFirstKeyOrClose))
+                                {
+                                        index++;
+
+                                        if(!closeContainer())
+                                        {
+                                                state = Error;
+                                        }
+                                }
+                                else if(c == '\"')
+                                {
+                                        state = InString;
+                                        stringIsKey = true;
+                                        skipToken = (stack.last().node < 0);
+                                        escape = false;
+                                        tokenStart = index;
+                                        index++;
+                                }
+                                else
+                                {
+                                        state = Error;
+                                }
+                                break;
+                        case ExpectColon:
+                                if(c == ':')
+                                {
+                                        index++;
+                                        state = ExpectValue;
+                                }
+                                else
+                                {
+                                        state = Error;
+                                }
+                                break;
+                        case ExpectCommaOrClose:
+                                if(c == ',')
+                                {
+                                        index++;
+
+                                        if(stack.last().object)
+                                        {
+                                                state = ExpectKey;
+                                        }
+                                        else
+                                        {
+                                                state = ExpectValue;
+                                                valueNode = stack.last().node;
+                                        }
+                                }
+                                else if(c == (stack.last().object ? '}' : ']'))
+                                {
+                                        index++;
+
+                                        if(!closeContainer())
+                                        {
+                                                state = Error;
+                                        }
+                                }
+                                else
+                                {
+                                        state = Error;
+                                }
+                                break;
+                        default:
+                                //Any data following the value is ignored, as in Json::parse
+                                index++;
+                                break;
+                }
+        }
+
+        if(((state == InString) || (state == InAtom)) && (tokenStart >= 0))
+        {
+                //A string or atom began at the very end of the chunk
+                buffer.append(data + tokenStart, length - tokenStart);
+                tokenStart = -1;
+        }
+
+        return state != Error;
+}
+
+/**
+ * finish
+ */
+bool JsonStreamParser::finish()
+{
+        if((state == InAtom) && (stack.isEmpty()))
+        {
+                //A top level number or literal is only terminated by the end of the data
+                if(!endAtom(0, 0))
+                {
+                        state = Error;
+                }
+        }
+
+        return state == Finished;
+}
+
+/**
+ * handler
+ */
+JsonHandler* JsonStreamParser::handler() const
+{
+        return eventHandler == &builder ? 0 : eventHandler;
+}
+
+/**
+ * setHandler
+ */
+void JsonStreamParser::setHandler(JsonHandler *handler)
+{
+        eventHandler = handler ? handler : &builder;
+}
+
+/**
+ * projection
+ */
+JsonProjection JsonStreamParser::projection() const
+{
+        return keyPaths;
+}
+
+/**
+ * setProjection
+ */
+void JsonStreamParser::setProjection(const JsonProjection &projection)
+{
+        keyPaths = projection;
+}
+
+/**
+ * result
+ */
+QVariant JsonStreamParser::result() const
+{
+        return builder.result();
+}
+
+/**
+ * hasError
+ */
+bool JsonStreamParser::hasError() const
+{
+        return state == Error;
+}
+
+/**
+ * isEmpty
+ */
+bool JsonStreamParser::isEmpty() const
+{
+        return empty;
+}
+
+/**
+ * reset
+ */
+void JsonStreamParser::reset()
+{
+        builder.reset();
+        stack.clear();
+        pendingKey.clear();
+        buffer.clear();
+        state = ExpectValue;
+        tokenStart = -1;
+        valueNode = 0;
+        skipToken = false;
+        stringIsKey = false;
+        escape = false;
+        empty = true;
+}
+
+/**
+ * elementsKey
+ */
+QString JsonStreamParser::elementsKey() const
+{
+        return builder.elementsKey();
+}
+
+/**
+ * setElementsKey
+ */
+void JsonStreamParser::setElementsKey(const QString &key)
+{
+        builder.setElementsKey(key);
+}
+
+/**
+ * takeElements
+ */
+QVariantList JsonStreamParser::takeElements()
+{
+        return builder.takeElements();
+}
+
+/**
+ * beginValue
+ */
+bool JsonStreamParser::beginValue(const char *data, int length, int &index)
+{
+        Q_UNUSED(length)
+
+        const int token = tokenTable[static_cast<unsigned char>(data[index])];
+        const bool container = (token == JsonTokenCurlyOpen) || (token == JsonTokenSquaredOpen);
+
+        if((!container) && ((token < JsonTokenString) || (token > JsonTokenNull)))
+        {
+                return false;
+        }
+
+        //Values outside of the projection are skipped, as are scalars that
+        //cannot contain the projected keys
+        const bool keep = (valueNode >= 0) && ((container) || (keyPaths.includesAll(valueNode)));
+
+        if((keep) && (!stack.isEmpty()) && (stack.last().object) && (!eventHandler->key(pendingKey)))
+        {
+                return false;
+        }
+
+        if(container)
+        {
+                Frame frame;
+                frame.object = (token == JsonTokenCurlyOpen);
+                frame.node = keep ? valueNode : -1;
+
+                if((keep) && (!(frame.object ? eventHandler->startObject() : eventHandler->startArray())))
+                {
+                        return false;
+                }
+
+                stack.append(frame);
+                state = frame.object ? ExpectFirstKeyOrClose : ExpectFirstValueOrClose;
+                valueNode = frame.node;
+                index++;
+                return true;
         }
 
-        QChar c = json[index];
+        state = (token == JsonTokenString) ? InString : InAtom;
+        stringIsKey = false;
+        skipToken = !keep;
+        escape = false;
+        tokenStart = index;
         index++;
-        switch(c.toLatin1())
+        return true;
+}
+
+/**
+ * addValue
+ */
+bool JsonStreamParser::addValue(const QVariant &v)
+{
+        if(!eventHandler->value(v))
         {
-                case '{': return JsonTokenCurlyOpen;
-                case '}': return JsonTokenCurlyClose;
-                case '[': return JsonTokenSquaredOpen;
-                case ']': return JsonTokenSquaredClose;
-                case ',': return JsonTokenComma;
-                case '"': return JsonTokenString;
-                case '0': case '1': case '2': case '3': case '4':
-                case '5': case '6': case '7': case '8': case '9':
-                case '-': return JsonTokenNumber;
-                case ':': return JsonTokenColon;
+                return false;
         }
 
-        index--;
+        endValue();
+        return true;
+}
+
+/**
+ * endValue
+ */
+void JsonStreamParser::endValue()
+{
+        state = stack.isEmpty() ? Finished : ExpectCommaOrClose;
+}
+
+/**
+ * closeContainer
+ */
+bool JsonStreamParser::closeContainer()
+{
+        const Frame frame = stack.last();
+        stack.resize(stack.size() - 1);
+
+        if((frame.node >= 0) && (!(frame.object ? eventHandler->endObject() : eventHandler->endArray())))
+        {
+                return false;
+        }
 
-        int remainingLength = json.size() - index;
+        endValue();
+        return true;
+}
 
-        //True
-        if(remainingLength >= 4)
+/**
+ * endString
+ */
+bool JsonStreamParser::endString(const char *data, int index)
+{
+        if(skipToken)
         {
-                if (json[index] == 't' && json[index + 1] == 'r' &&
-                        json[index + 2] == 'u' && json[index + 3] == 'e')
+                //Strings outside of the projection are not decoded
+                buffer.clear();
+                tokenStart = -1;
+
+                if(stringIsKey)
+                {
+                        valueNode = -1;
+                        state = ExpectColon;
+                }
+                else
                 {
-                        index += 4;
-                        return JsonTokenTrue;
+                        endValue();
                 }
+
+                return true;
+        }
+
+        bool success = true;
+        QVariant s;
+
+        if(tokenStart >= 0)
+        {
+                //The whole string is in the current chunk, so it is decoded in place
+                int start = tokenStart;
+                s = Json::parseString(data, index + 1, start, success);
+        }
+        else
+        {
+                buffer.append(data, index + 1);
+                int start = 0;
+                s = Json::parseString(buffer.constData(), buffer.size(), start, success);
+                buffer.clear();
+        }
+
+        tokenStart = -1;
+
+        if(!success)
+        {
+                return false;
+        }
+
+        if(stringIsKey)
+        {
+                //The key is passed to the handler along with its value, once
+                //it is known whether the value is in the projection
+                pendingKey = s.toString();
+                valueNode = keyPaths.child(stack.last().node, pendingKey);
+                state = ExpectColon;
+                return true;
+        }
+
+        return addValue(s);
+}
+
+/**
+ * endAtom
+ */
+bool JsonStreamParser::endAtom(const char *data, int index)
+{
+        if(skipToken)
+        {
+                buffer.clear();
+                tokenStart = -1;
+                endValue();
+                return true;
         }
 
-        //False
-        if (remainingLength >= 5)
+        const char *atom;
+        int atomLength;
+
+        if(tokenStart >= 0)
+        {
+                atom = data + tokenStart;
+                atomLength = index - tokenStart;
+        }
+        else
         {
-                if (json[index] == 'f' && json[index + 1] == 'a' &&
-                        json[index + 2] == 'l' && json[index + 3] == 's' &&
-                        json[index + 4] == 'e')
+                if(index > 0)
                 {
-                        index += 5;
-                        return JsonTokenFalse;
+                        buffer.append(data, index);
                 }
+
+                atom = buffer.constData();
+                atomLength = buffer.size();
         }
 
-        //Null
-        if (remainingLength >= 4)
+        tokenStart = -1;
+
+        QVariant v;
+        int i = 0;
+
+        if(tokenTable[static_cast<unsigned char>(atom[0])] == JsonTokenNumber)
+        {
+                v = Json::parseNumber(atom, atomLength, i);
+        }
+        else
         {
-                if (json[index] == 'n' && json[index + 1] == 'u' &&
-                        json[index + 2] == 'l' && json[index + 3] == 'l')
+                switch(Json::nextToken(atom, atomLength, i))
                 {
-                        index += 4;
-                        return JsonTokenNull;
+                        case JsonTokenTrue:
+                                v = QVariant(true);
+                                break;
+                        case JsonTokenFalse:
+                                v = QVariant(false);
+                                break;
+                        case JsonTokenNull:
+                                break;
+                        default:
+                                i = -1;
+                                break;
                 }
         }
 
-        return JsonTokenNone;
+        buffer.clear();
+
+        if(i != atomLength)
+        {
+                return false;
+        }
+
+        return addValue(v);
 }
 
 
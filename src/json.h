@@ -35,6 +35,15 @@
 
 #include <QVariant>
 #include <QString>
+#include <QByteArray>
+#include <QSharedData>
+#include <QVector>
+#include <QVariantMap>
+#include <QVariantList>
+#include <QStringList>
+#include <QMap>
+
+class QIODevice;
 
 namespace QtJson
 {
@@ -58,6 +67,411 @@ enum JsonToken
         JsonTokenNull = 11
 };
 
+/**
+ * \class JsonHandler
+ * \brief A receiver of JSON parser events
+ *
+ * JsonHandler is notified of each object, key, array and scalar value as
+ * it is parsed, so that only the data of interest needs to be kept. Each
+ * method returns false to stop the parsing. The default implementations
+ * ignore the event.
+ */
+class JsonHandler
+{
+        public:
+                virtual ~JsonHandler();
+
+                /**
+                 * Called when an object is started
+                 */
+                virtual bool startObject();
+
+                /**
+                 * Called with the name of each key/value pair of an object,
+                 * before its value
+                 *
+                 * \param name The name of the key/value pair
+                 */
+                virtual bool key(const QString &name);
+
+                /**
+                 * Called when an object is completed
+                 */
+                virtual bool endObject();
+
+                /**
+                 * Called when an array is started
+                 */
+                virtual bool startArray();
+
+                /**
+                 * Called when an array is completed
+                 */
+                virtual bool endArray();
+
+                /**
+                 * Called with each string, number, boolean and null value
+                 *
+                 * \param value The value
+                 */
+                virtual bool value(const QVariant &value);
+};
+
+/**
+ * \class JsonVariantBuilder
+ * \brief A JsonHandler that builds a QVariant hierarchy
+ */
+class JsonVariantBuilder : public JsonHandler
+{
+        public:
+                JsonVariantBuilder();
+
+                bool startObject();
+                bool key(const QString &name);
+                bool endObject();
+                bool startArray();
+                bool endArray();
+                bool value(const QVariant &value);
+
+                /**
+                 * Get the built value
+                 *
+                 * \return QVariant The top level value, once it is complete
+                 */
+                QVariant result() const;
+
+                /**
+                 * Discard any built data, ready to build a new value
+                 */
+                void reset();
+
+                /**
+                 * Get the key of the array whose elements are collected
+                 *
+                 * \return QString The key in the top level object
+                 */
+                QString elementsKey() const;
+
+                /**
+                 * Set the key of the array whose elements are collected
+                 *
+                 * Each element of the array at key in the top level object is
+                 * collected as soon as it is complete. The elements are still
+                 * added to the result.
+                 *
+                 * \param key The key in the top level object
+                 */
+                void setElementsKey(const QString &key);
+
+                /**
+                 * Take the elements that have been completed since the last call
+                 *
+                 * \return QVariantList The completed elements
+                 */
+                QVariantList takeElements();
+
+        private:
+                /**
+                 * \struct Frame
+                 * An object or array that is being built
+                 */
+                struct Frame
+                {
+                        bool object;
+                        QVariantMap map;
+                        QVariantList list;
+                        QString key;
+                };
+
+                /**
+                 * Add a completed value to the current container
+                 */
+                void addValue(const QVariant &value);
+
+                QVector<Frame> stack;
+                QVariant root;
+                QString elementKey;
+                QVariantList elements;
+};
+
+/**
+ * \class JsonProjection
+ * \brief A set of key paths to be kept when parsing JSON data
+ *
+ * Each path is a list of keys separated by periods, such as
+ * "paging.next". Arrays are transparent, so "pictures.sizes.link" keeps
+ * the link of every element of the sizes array, and may also be written
+ * as "pictures.sizes[*].link". Everything else is skipped by the
+ * tokenizer without being decoded. An empty projection keeps everything.
+ */
+class JsonProjection
+{
+        public:
+                JsonProjection();
+
+                /**
+                 * Create a projection of paths
+                 *
+                 * \param paths The key paths to be kept
+                 */
+                JsonProjection(const QStringList &paths);
+
+                /**
+                 * Get the key paths to be kept
+                 *
+                 * \return QStringList The key paths
+                 */
+                QStringList paths() const;
+
+                /**
+                 * Check whether the projection keeps everything
+                 */
+                bool isEmpty() const;
+
+        private:
+                friend class Json;
+                friend class JsonStreamParser;
+
+                /**
+                 * \struct Node
+                 * A key in the projection
+                 */
+                struct Node
+                {
+                        QMap<QString, int> children;
+                        bool all;
+                };
+
+                /**
+                 * Get the node of key in node
+                 *
+                 * \return int The child node, or -1 if key is skipped
+                 */
+                int child(int node, const QString &key) const;
+
+                /**
+                 * Check whether everything below node is kept
+                 */
+                bool includesAll(int node) const;
+
+                QVector<Node> nodes;
+                QStringList pathList;
+};
+
+class JsonDocument;
+class JsonDocumentData;
+
+/**
+ * \class JsonValue
+ * \brief A value in a JsonDocument
+ *
+ * JsonValue is a lightweight reference to a value in a JsonDocument. It
+ * shares the data of the document, so it remains valid after the document
+ * is destroyed. Strings are decoded from the source data when they are
+ * accessed.
+ */
+class JsonValue
+{
+        public:
+                /**
+                 * \enum Type
+                 */
+                enum Type
+                {
+                        Undefined = 0,
+                        Null,
+                        Bool,
+                        Integer,
+                        UnsignedInteger,
+                        Double,
+                        String,
+                        Array,
+                        Object
+                };
+
+                /**
+                 * Create an undefined value
+                 */
+                JsonValue();
+
+                /**
+                 * Get the type of the value
+                 */
+                Type type() const;
+
+                bool isUndefined() const;
+                bool isNull() const;
+                bool isBool() const;
+                bool isNumber() const;
+                bool isString() const;
+                bool isArray() const;
+                bool isObject() const;
+
+                /**
+                 * Get the value of a boolean
+                 */
+                bool toBool() const;
+
+                /**
+                 * Get the value of a number as a double
+                 */
+                double toDouble() const;
+
+                /**
+                 * Get the value of a number as an integer
+                 */
+                qlonglong toLongLong() const;
+
+                /**
+                 * Get the value of a string
+                 */
+                QString toString() const;
+
+                /**
+                 * Get the number of elements of an array, or members of an object
+                 */
+                int size() const;
+
+                /**
+                 * Get the element at i of an array
+                 *
+                 * The preceding elements are stepped over, without being decoded.
+                 *
+                 * \return JsonValue The element, or an undefined value if there is none
+                 */
+                JsonValue at(int i) const;
+
+                /**
+                 * Get the value of key in an object
+                 *
+                 * \return JsonValue The value, or an undefined value if there is none
+                 */
+                JsonValue value(const QString &key) const;
+
+                /**
+                 * Get the keys of an object
+                 */
+                QStringList keys() const;
+
+                /**
+                 * Convert the value to a QVariant hierarchy
+                 *
+                 * \return QVariant The same value that Json::parse would produce
+                 */
+                QVariant toVariant() const;
+
+        private:
+                friend class JsonDocument;
+
+                JsonValue(JsonDocumentData *data, int node);
+
+                /**
+                 * Get the node following the value at node
+                 */
+                int next(int node) const;
+
+                QExplicitlySharedDataPointer<JsonDocumentData> doc;
+                int index;
+};
+
+/**
+ * \class JsonDocumentData
+ * \brief The parsed data shared by a JsonDocument and its values
+ */
+class JsonDocumentData : public QSharedData
+{
+        public:
+                /**
+                 * \struct Node
+                 * A value, stored in document order
+                 */
+                struct Node
+                {
+                        JsonValue::Type type;
+
+                        /**
+                         * The length of a string in bytes, or the number of
+                         * elements or members of a container
+                         */
+                        int size;
+
+                        /**
+                         * The node following the value and its children
+                         */
+                        int end;
+
+                        /**
+                         * Whether a string contains escape sequences
+                         */
+                        bool escaped;
+
+                        union
+                        {
+                                bool boolean;
+                                qlonglong integer;
+                                qulonglong unsignedInteger;
+                                double real;
+                                int offset;
+                        } data;
+                };
+
+                QByteArray json;
+                QVector<Node> nodes;
+};
+
+/**
+ * \class JsonDocument
+ * \brief A compact representation of parsed JSON data
+ *
+ * JsonDocument stores all of the values of the parsed data contiguously,
+ * rather than as individually allocated QVariants, and keeps a reference
+ * to the source data, so that strings are only decoded when they are
+ * accessed. It is created by Json::parseDocument(), and copies are cheap.
+ */
+class JsonDocument
+{
+        public:
+                /**
+                 * Create a null document
+                 */
+                JsonDocument();
+
+                /**
+                 * Check whether the document holds no value
+                 */
+                bool isNull() const;
+
+                /**
+                 * Get the top level value
+                 */
+                JsonValue root() const;
+
+                /**
+                 * Get the value at a JSON Pointer (RFC 6901), such as "/data/3/name"
+                 *
+                 * Only the objects and arrays along the pointer are visited,
+                 * and nothing is decoded except the keys that are compared.
+                 *
+                 * \param pointer The JSON Pointer
+                 *
+                 * \return JsonValue The value, or an undefined value if there is none
+                 */
+                JsonValue value(const QString &pointer) const;
+
+                /**
+                 * Convert the document to a QVariant hierarchy
+                 *
+                 * \return QVariant The same value that Json::parse would produce
+                 */
+                QVariant toVariant() const;
+
+        private:
+                friend class Json;
+                friend class JsonValue;
+
+                QExplicitlySharedDataPointer<JsonDocumentData> d;
+};
+
 /**
  * \class Json
  * \brief A JSON data parser
@@ -82,6 +496,104 @@ class Json
                  */
                 static QVariant parse(const QString &json, bool &success);
 
+                /**
+                 * Parse UTF-8 encoded JSON data
+                 *
+                 * \param json The JSON data
+                 */
+                static QVariant parse(const QByteArray &json);
+
+                /**
+                 * Parse UTF-8 encoded JSON data
+                 *
+                 * \param json The JSON data
+                 * \param success The success of the parsing
+                 */
+                static QVariant parse(const QByteArray &json, bool &success);
+
+                /**
+                 * Parse UTF-8 encoded JSON data
+                 *
+                 * The data is read in place, and strings are only decoded
+                 * when their values are created.
+                 *
+                 * \param json The JSON data
+                 * \param length The length of the JSON data in bytes
+                 * \param success The success of the parsing
+                 */
+                static QVariant parse(const char *json, int length, bool &success);
+
+                /**
+                 * Parse UTF-8 encoded JSON data, passing each event to handler
+                 *
+                 * No QVariant hierarchy is built, so the handler decides
+                 * which data is kept.
+                 *
+                 * \param json The JSON data
+                 * \param handler The handler of the parser events
+                 *
+                 * \return true if the data was parsed and the handler did not stop it
+                 */
+                static bool parse(const QByteArray &json, JsonHandler *handler);
+
+                /**
+                 * Parse UTF-8 encoded JSON data, passing each event to handler
+                 *
+                 * \param json The JSON data
+                 * \param length The length of the JSON data in bytes
+                 * \param handler The handler of the parser events
+                 *
+                 * \return true if the data was parsed and the handler did not stop it
+                 */
+                static bool parse(const char *json, int length, JsonHandler *handler);
+
+                /**
+                 * Parse UTF-8 encoded JSON data, keeping only the paths in projection
+                 *
+                 * Values outside of the projection are skipped without being
+                 * decoded. Objects in the projection only contain the keys
+                 * that lead to the projected paths.
+                 *
+                 * \param json The JSON data
+                 * \param projection The key paths to be kept
+                 * \param success The success of the parsing
+                 */
+                static QVariant parse(const QByteArray &json, const JsonProjection &projection, bool &success);
+
+                /**
+                 * Parse UTF-8 encoded JSON data, passing the events of the paths
+                 * in projection to handler
+                 *
+                 * \param json The JSON data
+                 * \param length The length of the JSON data in bytes
+                 * \param projection The key paths to be kept
+                 * \param handler The handler of the parser events
+                 *
+                 * \return true if the data was parsed and the handler did not stop it
+                 */
+                static bool parse(const char *json, int length, const JsonProjection &projection,
+                                  JsonHandler *handler);
+
+                /**
+                 * Parse UTF-8 encoded JSON data into a compact document
+                 *
+                 * \param json The JSON data
+                 * \param success The success of the parsing
+                 *
+                 * \return JsonDocument The document, which is null if parsing failed
+                 */
+                static JsonDocument parseDocument(const QByteArray &json, bool &success);
+
+                /**
+                 * Get the value at a JSON Pointer (RFC 6901) in a QVariant hierarchy
+                 *
+                 * \param data The JSON data generated by the parser
+                 * \param pointer The JSON Pointer, such as "/data/3/name"
+                 *
+                 * \return QVariant The value, or an invalid QVariant if there is none
+                 */
+                static QVariant pointerValue(const QVariant &data, const QString &pointer);
+
                 /**
                 * This method generates a textual JSON representation
                 *
@@ -100,102 +612,426 @@ class Json
                 */
                 static QByteArray serialize(const QVariant &data, bool &success);
 
+                /**
+                * This method writes a textual JSON representation to a device
+                *
+                * The data is written in chunks as it is generated, rather
+                * than being held in memory in its entirety.
+                *
+                * \param data The JSON data generated by the parser.
+                * \param device The device to write to
+                *
+                * \return bool The success of the serialization
+                */
+                static bool serialize(const QVariant &data, QIODevice *device);
+
         private:
+                friend class JsonStreamParser;
+                friend class JsonValue;
+
                 /**
                  * Parses a value starting from index
                  *
                  * \param json The JSON data
+                 * \param length The length of the JSON data
                  * \param index The start index
-                 * \param success The success of the parse process
+                 * \param handler The handler of the parser events
                  *
-                 * \return QVariant The parsed value
+                 * \return bool The success of the parse process
                  */
-                static QVariant parseValue(const QString &json, int &index,
-                                                                   bool &success);
+                static bool parseValue(const char *json, int length, int &index,
+                                       JsonHandler *handler);
 
                 /**
                  * Parses an object starting from index
                  *
                  * \param json The JSON data
+                 * \param length The length of the JSON data
                  * \param index The start index
-                 * \param success The success of the object parse
+                 * \param handler The handler of the parser events
                  *
-                 * \return QVariant The parsed object map
+                 * \return bool The success of the object parse
                  */
-                static QVariant parseObject(const QString &json, int &index,
-                                                                           bool &success);
+                static bool parseObject(const char *json, int length, int &index,
+                                        JsonHandler *handler);
 
                 /**
                  * Parses an array starting from index
                  *
                  * \param json The JSON data
+                 * \param length The length of the JSON data
                  * \param index The starting index
-                 * \param success The success of the array parse
+                 * \param handler The handler of the parser events
                  *
-                 * \return QVariant The parsed variant array
+                 * \return bool The success of the array parse
                  */
-                static QVariant parseArray(const QString &json, int &index,
-                                                                           bool &success);
+                static bool parseArray(const char *json, int length, int &index,
+                                       JsonHandler *handler);
+
+                /**
+                 * Parses a value in node of projection starting from index
+                 *
+                 * \param json The JSON data
+                 * \param length The length of the JSON data
+                 * \param index The start index
+                 * \param projection The key paths to be kept
+                 * \param node The node of the value in the projection
+                 * \param handler The handler of the parser events
+                 *
+                 * \return bool The success of the parse process
+                 */
+                static bool parseProjectedValue(const char *json, int length, int &index,
+                                                const JsonProjection &projection, int node,
+                                                JsonHandler *handler);
+
+                /**
+                 * Parses an object in node of projection starting from index
+                 *
+                 * \param json The JSON data
+                 * \param length The length of the JSON data
+                 * \param index The start index
+                 * \param projection The key paths to be kept
+                 * \param node The node of the object in the projection
+                 * \param handler The handler of the parser events
+                 *
+                 * \return bool The success of the object parse
+                 */
+                static bool parseProjectedObject(const char *json, int length, int &index,
+                                                 const JsonProjection &projection, int node,
+                                                 JsonHandler *handler);
+
+                /**
+                 * Parses an array in node of projection starting from index
+                 *
+                 * \param json The JSON data
+                 * \param length The length of the JSON data
+                 * \param index The start index
+                 * \param projection The key paths to be kept
+                 * \param node The node of the array elements in the projection
+                 * \param handler The handler of the parser events
+                 *
+                 * \return bool The success of the array parse
+                 */
+                static bool parseProjectedArray(const char *json, int length, int &index,
+                                                const JsonProjection &projection, int node,
+                                                JsonHandler *handler);
+
+                /**
+                 * Parses a value starting from index into the nodes of a document
+                 *
+                 * Strings are located but not decoded.
+                 *
+                 * \param json The JSON data
+                 * \param length The length of the JSON data
+                 * \param index The start index
+                 * \param nodes The nodes of the document
+                 *
+                 * \return bool The success of the parse process
+                 */
+                static bool parseDocumentValue(const char *json, int length, int &index,
+                                               QVector<JsonDocumentData::Node> &nodes);
+
+                /**
+                 * Append the textual JSON representation of data to str
+                 *
+                 * \param data The JSON data
+                 * \param str The buffer to append to
+                 * \param device The device that completed chunks of str are
+                 * written to, if any
+                 *
+                 * \return bool The success of the serialization
+                 */
+                static bool writeValue(const QVariant &data, QByteArray &str, QIODevice *device);
+
+                /**
+                 * Append a quoted and escaped string to str
+                 *
+                 * \param value The string
+                 * \param str The buffer to append to
+                 */
+                static void writeString(const QString &value, QByteArray &str);
+
+                /**
+                 * Skip a value starting from index without decoding it
+                 *
+                 * \param json The JSON data
+                 * \param length The length of the JSON data
+                 * \param index The start index
+                 *
+                 * \return bool The success of the skip
+                 */
+                static bool skipValue(const char *json, int length, int &index);
 
                 /**
                  * Parses a string starting from index
                  *
                  * \param json The JSON data
+                 * \param length The length of the JSON data
                  * \param index The starting index
                  * \param success The success of the string parse
                  *
                  * \return QVariant The parsed string
                  */
-                static QVariant parseString(const QString &json, int &index,
+                static QVariant parseString(const char *json, int length, int &index,
                                                                         bool &success);
 
                 /**
                  * Parses a number starting from index
                  *
                  * \param json The JSON data
+                 * \param length The length of the JSON data
                  * \param index The starting index
                  *
                  * \return QVariant The parsed number
                  */
-                static QVariant parseNumber(const QString &json, int &index);
+                static QVariant parseNumber(const char *json, int length, int &index);
 
                 /**
                  * Get the last index of a number starting from index
                  *
                  * \param json The JSON data
+                 * \param length The length of the JSON data
                  * \param index The starting index
                  *
                  * \return The last index of the number
                  */
-                static int lastIndexOfNumber(const QString &json, int index);
+                static int lastIndexOfNumber(const char *json, int length, int index);
 
                 /**
                  * Skip unwanted whitespace symbols starting from index
                  *
                  * \param json The JSON data
+                 * \param length The length of the JSON data
                  * \param index The start index
                  */
-                static void eatWhitespace(const QString &json, int &index);
+                static void eatWhitespace(const char *json, int length, int &index);
 
                 /**
                  * Check what token lies ahead
                  *
+                 * Whitespace is skipped, leaving index at the start of the
+                 * upcoming token, so that it is only scanned once.
+                 *
                  * \param json The JSON data
+                 * \param length The length of the JSON data
                  * \param index The starting index
                  *
                  * \return int The upcoming token
                  */
-                static int lookAhead(const QString &json, int index);
+                static int lookAhead(const char *json, int length, int &index);
 
                 /**
                  * Get the next JSON token
                  *
                  * \param json The JSON data
+                 * \param length The length of the JSON data
                  * \param index The starting index
                  *
                  * \return int The next JSON token
                  */
-                static int nextToken(const QString &json, int &index);
+                static int nextToken(const char *json, int length, int &index);
+};
+
+
+/**
+ * \class JsonStreamParser
+ * \brief An incremental JSON data parser
+ *
+ * JsonStreamParser parses JSON data into a QVariant hierarchy as it is
+ * fed, so that the data does not need to be available in its entirety
+ * before parsing can begin. Alternatively, the parser events can be
+ * passed to a JsonHandler.
+ */
+class JsonStreamParser
+{
+        public:
+                JsonStreamParser();
+
+                /**
+                 * Parse the next chunk of UTF-8 encoded JSON data
+                 *
+                 * \param data The JSON data
+                 *
+                 * \return false if the data cannot be parsed
+                 */
+                bool feed(const QByteArray &data);
+
+                /**
+                 * Parse the next chunk of UTF-8 encoded JSON data
+                 *
+                 * \param data The JSON data
+                 * \param length The length of the JSON data in bytes
+                 *
+                 * \return false if the data cannot be parsed
+                 */
+                bool feed(const char *data, int length);
+
+                /**
+                 * Complete the parsing once all data has been fed
+                 *
+                 * \return true if a complete value was parsed
+                 */
+                bool finish();
+
+                /**
+                 * Get the handler of the parser events
+                 *
+                 * \return JsonHandler* The handler, or 0 if the value is built
+                 */
+                JsonHandler* handler() const;
+
+                /**
+                 * Set the handler of the parser events
+                 *
+                 * The parser does not take ownership of the handler. When no
+                 * handler is set, the parsed value is built and returned by
+                 * result().
+                 *
+                 * \param handler The handler, or 0 to build the value
+                 */
+                void setHandler(JsonHandler *handler);
+
+                /**
+                 * Get the key paths to be kept
+                 *
+                 * \return JsonProjection The projection
+                 */
+                JsonProjection projection() const;
+
+                /**
+                 * Set the key paths to be kept
+                 *
+                 * Values outside of the projection are skipped without being
+                 * decoded or passed to the handler. The projection should be
+                 * set before any data is fed.
+                 *
+                 * \param projection The projection
+                 */
+                void setProjection(const JsonProjection &projection);
+
+                /**
+                 * Get the parsed value
+                 *
+                 * \return QVariant The parsed value, once finish() has succeeded
+                 */
+                QVariant result() const;
+
+                /**
+                 * Check whether the data fed so far cannot be parsed
+                 */
+                bool hasError() const;
+
+                /**
+                 * Check whether any data has been fed since the last reset
+                 */
+                bool isEmpty() const;
+
+                /**
+                 * Discard any parsed data, ready to parse a new value
+                 */
+                void reset();
+
+                /**
+                 * Get the key of the array whose elements are collected
+                 *
+                 * \return QString The key in the top level object
+                 */
+                QString elementsKey() const;
+
+                /**
+                 * Set the key of the array whose elements are collected
+                 *
+                 * Each element of the array at key in the top level object is
+                 * collected as soon as it is complete, so that it can be used
+                 * before the rest of the data has been parsed. The elements are
+                 * still added to the result.
+                 *
+                 * \param key The key in the top level object
+                 */
+                void setElementsKey(const QString &key);
+
+                /**
+                 * Take the elements that have been completed since the last call
+                 *
+                 * \return QVariantList The completed elements
+                 */
+                QVariantList takeElements();
+
+        private:
+                /**
+                 * \enum State
+                 */
+                enum State
+                {
+                        ExpectValue = 0,
+                        ExpectFirstValueOrClose,
+                        ExpectFirstKeyOrClose,
+                        ExpectKey,
+                        ExpectColon,
+                        ExpectCommaOrClose,
+                        InString,
+                        InAtom,
+                        Finished,
+                        Error
+                };
+
+                /**
+                 * \struct Frame
+                 * An object or array that is being parsed
+                 */
+                struct Frame
+                {
+                        bool object;
+                        int node;
+                };
+
+                /**
+                 * Start parsing a value at index
+                 *
+                 * \return false if no value can start at index
+                 */
+                bool beginValue(const char *data, int length, int &index);
+
+                /**
+                 * Pass a completed value to the handler
+                 */
+                bool addValue(const QVariant &value);
+
+                /**
+                 * Complete the current value
+                 */
+                void endValue();
+
+                /**
+                 * Close the current container
+                 */
+                bool closeContainer();
+
+                /**
+                 * Complete a string ending at index
+                 */
+                bool endString(const char *data, int index);
+
+                /**
+                 * Complete a number or literal ending before index
+                 */
+                bool endAtom(const char *data, int index);
+
+                Q_DISABLE_COPY(JsonStreamParser)
+
+                JsonVariantBuilder builder;
+                JsonHandler *eventHandler;
+                JsonProjection keyPaths;
+                QVector<Frame> stack;
+                QString pendingKey;
+                QByteArray buffer;
+                State state;
+                int tokenStart;
+                int valueNode;
+                bool skipToken;
+                bool stringIsKey;
+                bool escape;
+                bool empty;
 };
 
 
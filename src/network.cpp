@@ -0,0 +1,699 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "network.h"
+#include "urls.h"
+#include <QCache>
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPointer>
+#include <QSslConfiguration>
+#include <QStringList>
+#include <QSet>
+#if QT_VERSION >= 0x050000
+#include <QStandardPaths>
+#endif
+#include <QThread>
+#include <QThreadStorage>
+#include <QTimer>
+#include <QUrl>
+#include <algorithm>
+#ifdef QVIMEO_DEBUG
+#include <QDebug>
+#endif
+
+namespace QVimeo {
+
+// The managers are owned by the application or their thread, so they are not deleted by the storage
+static QThreadStorage<QPointer<QNetworkAccessManager> > managers;
+
+static QAtomicInt requests(0);
+static QAtomicInt handshakes(0);
+static QAtomicInt resumedHandshakes(0);
+static QAtomicInt fullHandshakes(0);
+static QAtomicInt redirectsAvoided(0);
+static QAtomicInt hedges(0);
+static QAtomicInt hedgeWins(0);
+
+// The number of recent response times that are kept for each host
+static const int MAX_LATENCY_SAMPLES = 100;
+
+struct LatencyData
+{
+    QMutex mutex;
+    QHash<QString, QList<int> > samples;
+};
+
+Q_GLOBAL_STATIC(LatencyData, latencyData)
+
+struct ProtocolData
+{
+    QMutex mutex;
+    QSet<QString> multiplexedHosts;
+};
+
+Q_GLOBAL_STATIC(ProtocolData, protocolData)
+
+// The maximum number of permanent redirects that are remembered
+static const int MAX_REDIRECT_ENTRIES = 1000;
+// Limits the length of a chain of remembered redirects, in case they form a loop
+static const int MAX_REDIRECT_HOPS = 8;
+
+struct RedirectEntry
+{
+    QUrl target;
+    bool allMethods;
+};
+
+struct RedirectData
+{
+    RedirectData() :
+        entries(MAX_REDIRECT_ENTRIES)
+    {
+    }
+
+    QMutex mutex;
+    QCache<QString, RedirectEntry> entries;
+};
+
+Q_GLOBAL_STATIC(RedirectData, redirectData)
+
+// Increment when the format of the SSL session file changes
+static const qint32 SSL_SESSION_FILE_VERSION = 1;
+// New sessions are written to the file together, at most this often
+static const int SSL_SESSION_SAVE_DELAY = 10000;
+
+struct SslSessionData
+{
+    SslSessionData() :
+        loaded(false),
+        modified(false),
+        saveScheduled(false),
+        postRoutineAdded(false)
+    {
+#if QT_VERSION >= 0x050000
+        const QString path = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+
+        if (!path.isEmpty()) {
+            fileName = path + "/qvimeo-ssl-sessions";
+        }
+#endif
+    }
+
+    void load() {
+        loaded = true;
+        sessions.clear();
+        QFile file(fileName);
+
+        if ((fileName.isEmpty()) || (!file.open(QFile::ReadOnly))) {
+            return;
+        }
+
+        QDataStream stream(&file);
+        qint32 version = 0;
+        stream >> version;
+
+        if (version == SSL_SESSION_FILE_VERSION) {
+            stream >> sessions;
+        }
+#ifdef QVIMEO_DEBUG
+        qDebug() << "QVimeo::SslSessionData::load" << fileName << sessions.keys();
+#endif
+    }
+
+    void save() {
+        modified = false;
+
+        if (fileName.isEmpty()) {
+            return;
+        }
+
+        QDir().mkpath(QFileInfo(fileName).path());
+        QFile file(fileName);
+
+        if (!file.open(QFile::WriteOnly)) {
+#ifdef QVIMEO_DEBUG
+            qDebug() << "QVimeo::SslSessionData::save: Unable to write" << fileName;
+#endif
+            return;
+        }
+
+        // The sessions allow the connections to be resumed, so keep them private
+        file.setPermissions(QFile::ReadOwner | QFile::WriteOwner);
+        QDataStream stream(&file);
+        stream << SSL_SESSION_FILE_VERSION << sessions;
+    }
+
+    QMutex mutex;
+    QString fileName;
+    QHash<QString, QByteArray> sessions;
+    bool loaded;
+    bool modified;
+    bool saveScheduled;
+    bool postRoutineAdded;
+};
+
+Q_GLOBAL_STATIC(SslSessionData, sslSessionData)
+
+static void saveSslSessions() {
+    SslSessionData *data = sslSessionData();
+    QMutexLocker locker(&data->mutex);
+    data->saveScheduled = false;
+
+    if (data->modified) {
+        data->save();
+    }
+}
+
+// Saves the sessions from the event loop of the main thread, rather than as each one is added
+static void scheduleSslSessionSave(SslSessionData *data) {
+    if (!data->postRoutineAdded) {
+        // Sessions added since the last save are written when the application exits
+        data->postRoutineAdded = true;
+        qAddPostRoutine(saveSslSessions);
+    }
+#if QT_VERSION >= 0x050400
+    QCoreApplication *app = QCoreApplication::instance();
+
+    if ((app) && (!data->saveScheduled)) {
+        data->saveScheduled = true;
+        QTimer::singleShot(SSL_SESSION_SAVE_DELAY, app, saveSslSessions);
+    }
+#endif
+}
+
+// Sessions are only cached for the hosts of the Vimeo APIs
+static bool isSslSessionHost(const QString &host) {
+    return (host == QUrl(API_URL).host()) || (host == QUrl(VIDEO_PAGE_URL).host());
+}
+
+#if QT_VERSION >= 0x050100
+static void onReplyEncrypted() {
+    handshakes.fetchAndAddOrdered(1);
+}
+#endif
+
+/*!
+    \class Network
+    \brief Provides the network layer shared by all requests.
+
+    \ingroup requests
+
+    Unless another QNetworkAccessManager is set, each Request, ResourcesModel, StreamsModel and Dispatcher uses 
+    the QNetworkAccessManager returned by networkAccessManager(). There is one instance per thread, so 
+    requests made from the same thread share its pool of keep-alive connections, and only the first request 
+    to each host pays for the TCP and TLS handshakes.
+    
+    With Qt 5.8 or later, requests allow HTTP/2, so that where the server supports it, concurrent requests to 
+    the same host are multiplexed over a single connection. With earlier versions, or where the server does 
+    not support HTTP/2, HTTP/1.1 is used without pipelining, and QNetworkAccessManager spreads the requests 
+    over a pool of up to 6 connections to each host.
+    
+    The first request to each host must also wait for a DNS lookup and the TCP and TLS handshakes. Call 
+    warmUp() at startup (or preconnect() from QML) to make these in advance, so that the first request to the 
+    Vimeo APIs starts sooner.
+    
+    Example usage (QML):
+    
+    \code
+    import QtQuick 1.0
+    import QVimeo 1.0
+    
+    Network {
+        id: network
+        
+        Component.onCompleted: network.preconnect()
+    }
+    \endcode
+    
+    \sa isMultiplexed()
+*/
+
+/*!
+    \brief Constructs a Network with \a parent.
+    
+    Instances are only needed to call preconnect() from QML. All other methods are static.
+*/
+Network::Network(QObject *parent) :
+    QObject(parent)
+{
+}
+
+/*!
+    \brief Returns the QNetworkAccessManager shared by the requests made from the current thread.
+
+    The instance is created when first required. The instance for the main thread is a child of the 
+    QCoreApplication, and is deleted with it. The instances for other threads are deleted when the thread 
+    finishes.
+*/
+QNetworkAccessManager* Network::networkAccessManager() {
+    QNetworkAccessManager *manager = managers.hasLocalData() ? managers.localData() : 0;
+
+    if (!manager) {
+        QCoreApplication *app = QCoreApplication::instance();
+
+        if ((app) && (app->thread() == QThread::currentThread())) {
+            // QNetworkAccessManager cannot be deleted once the application has gone, during static destruction
+            manager = new QNetworkAccessManager(app);
+        }
+        else {
+            manager = new QNetworkAccessManager;
+            QObject::connect(QThread::currentThread(), SIGNAL(finished()), manager, SLOT(deleteLater()));
+        }
+
+        managers.setLocalData(manager);
+#ifdef QVIMEO_DEBUG
+        qDebug() << "QVimeo::Network::networkAccessManager: Created" << manager;
+#endif
+    }
+
+    return manager;
+}
+
+/*!
+    \brief Connects to the hosts of the Vimeo APIs in advance, using \a manager.
+
+    If \a manager is 0, the manager returned by networkAccessManager() for the current thread is used. The 
+    connections are kept alive, and are reused by the first requests to each host.
+
+    This is only available with Qt 5.2 or later, and does nothing with earlier versions.
+
+    \sa preconnect()
+*/
+void Network::warmUp(QNetworkAccessManager *manager) {
+#if QT_VERSION >= 0x050200
+    if (!manager) {
+        manager = networkAccessManager();
+    }
+
+    QStringList hosts;
+    hosts << QUrl(API_URL).host() << QUrl(VIDEO_PAGE_URL).host();
+    
+    foreach (const QString &host, hosts) {
+#ifdef QVIMEO_DEBUG
+        qDebug() << "QVimeo::Network::warmUp" << host;
+#endif
+#if QT_VERSION >= 0x050d00
+        // Offer HTTP/2, so that the connection can be reused by requests that allow it
+        QSslConfiguration config = QSslConfiguration::defaultConfiguration();
+        config.setAllowedNextProtocols(QList<QByteArray>() << QSslConfiguration::ALPNProtocolHTTP2
+                                                           << QSslConfiguration::NextProtocolHttp1_1);
+        manager->connectToHostEncrypted(host, 443, config);
+#else
+        manager->connectToHostEncrypted(host);
+#endif
+    }
+#else
+    Q_UNUSED(manager)
+#endif
+}
+
+/*!
+    \brief Connects to the hosts of the Vimeo APIs in advance, using the manager returned by 
+    networkAccessManager() for the current thread.
+
+    This is equivalent to warmUp(), and is provided for use from QML.
+*/
+void Network::preconnect() {
+    warmUp();
+}
+
+/*!
+    \brief Returns the number of HTTPS requests made since the counters were last reset.
+
+    Each redirect is counted as a separate request.
+
+    \sa resetCounters()
+*/
+int Network::requestCount() {
+    return requests.fetchAndAddOrdered(0);
+}
+
+/*!
+    \brief Returns the number of TLS handshakes performed since the counters were last reset.
+
+    Handshakes are only counted with Qt 5.1 or later, so this is always 0 with earlier versions.
+
+    \sa resetCounters()
+*/
+int Network::handshakeCount() {
+    return handshakes.fetchAndAddOrdered(0);
+}
+
+/*!
+    \brief Returns the number of HTTPS requests that reused an existing connection, and so did not need a 
+    TLS handshake, since the counters were last reset.
+
+    This is only available with Qt 5.1 or later, and is always 0 with earlier versions.
+
+    \sa resetCounters()
+*/
+int Network::handshakesSaved() {
+#if QT_VERSION >= 0x050100
+    return qMax(0, requestCount() - handshakeCount());
+#else
+    return 0;
+#endif
+}
+
+/*!
+    \brief Returns the response time in milliseconds within which \a percentile percent of the recent 
+    successful requests to \a host finished, or -1 if there have not yet been enough requests to \a host.
+
+    \sa Request::hedgingPercentile
+*/
+int Network::latency(const QString &host, int percentile) {
+    LatencyData *data = latencyData();
+    QMutexLocker locker(&data->mutex);
+    QList<int> samples = data->samples.value(host);
+
+    if (samples.size() < MAX_LATENCY_SAMPLES / 5) {
+        return -1;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    return samples.at(qBound(0, samples.size() * percentile / 100, samples.size() - 1));
+}
+
+/*!
+    \brief Returns true if the last successful request to \a host used HTTP/2, and so further requests to 
+    \a host are multiplexed over a single connection.
+
+    This is only available with Qt 5.9 or later, and is always false with earlier versions.
+
+    \sa Dispatcher::maximumStreamsPerHost
+*/
+bool Network::isMultiplexed(const QString &host) {
+    ProtocolData *data = protocolData();
+    QMutexLocker locker(&data->mutex);
+    return data->multiplexedHosts.contains(host);
+}
+
+/*!
+    \brief Returns the name of the file in which the TLS sessions for the hosts of the Vimeo APIs are stored.
+
+    With Qt 5.2 or later, the TLS sessions established with the hosts of the Vimeo APIs are stored, and are 
+    offered when connecting to those hosts again, so that the server can resume the session using an 
+    abbreviated handshake. The sessions are kept in this file, so that they can also be resumed after the 
+    application is restarted. New sessions are written together, up to 10 seconds after they are established 
+    (with Qt 5.4 or later) and when the application exits, rather than as each one arrives.
+
+    The default is a file named qvimeo-ssl-sessions in QStandardPaths::CacheLocation. If the file name is 
+    empty, the sessions are only kept in memory.
+
+    \sa resumedHandshakeCount(), fullHandshakeCount()
+*/
+QString Network::sslSessionFileName() {
+    SslSessionData *data = sslSessionData();
+    QMutexLocker locker(&data->mutex);
+    return data->fileName;
+}
+
+/*!
+    \brief Sets the name of the file in which the TLS sessions are stored to \a fileName.
+
+    Any sessions stored in \a fileName are loaded when next required.
+
+    \sa sslSessionFileName()
+*/
+void Network::setSslSessionFileName(const QString &fileName) {
+    SslSessionData *data = sslSessionData();
+    QMutexLocker locker(&data->mutex);
+
+    if (fileName != data->fileName) {
+        if (data->modified) {
+            data->save();
+        }
+
+        data->fileName = fileName;
+        data->loaded = false;
+    }
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::Network::setSslSessionFileName" << fileName;
+#endif
+}
+
+/*!
+    \brief Returns the number of TLS handshakes with the hosts of the Vimeo APIs that resumed a stored 
+    session since the counters were last reset.
+
+    A handshake is counted as resumed when the session returned by the server is the one that was offered. A 
+    server that issues a new session ticket when resuming a session is counted as a full handshake.
+
+    This is only available with Qt 5.2 or later, and is always 0 with earlier versions.
+
+    \sa fullHandshakeCount(), sslSessionFileName(), resetCounters()
+*/
+int Network::resumedHandshakeCount() {
+    return resumedHandshakes.fetchAndAddOrdered(0);
+}
+
+/*!
+    \brief Returns the number of full TLS handshakes with the hosts of the Vimeo APIs since the counters 
+    were last reset.
+
+    This is only available with Qt 5.2 or later, and is always 0 with earlier versions.
+
+    \sa resumedHandshakeCount(), sslSessionFileName(), resetCounters()
+*/
+int Network::fullHandshakeCount() {
+    return fullHandshakes.fetchAndAddOrdered(0);
+}
+
+/*!
+    \brief Returns the number of redirects that were not requested since the counters were last reset, 
+    because the request was sent straight to the location that a previous request had been permanently 
+    redirected to.
+
+    The targets of permanent redirects (status 301 or 308) are remembered for the most recent 1000 URLs. A 
+    target remembered from a 301 redirect is only used for GET and HEAD requests, since other requests may 
+    have been changed to GET when the redirect was followed.
+
+    \sa clearRedirects(), resetCounters()
+*/
+int Network::redirectsSaved() {
+    return redirectsAvoided.fetchAndAddOrdered(0);
+}
+
+/*!
+    \brief Forgets the targets of all permanent redirects.
+
+    \sa redirectsSaved()
+*/
+void Network::clearRedirects() {
+    RedirectData *data = redirectData();
+    QMutexLocker locker(&data->mutex);
+    data->entries.clear();
+}
+
+/*!
+    \brief Returns the number of hedged requests that have been sent since the counters were last reset.
+
+    \sa Request::hedgingEnabled, resetCounters()
+*/
+int Network::hedgeCount() {
+    return hedges.fetchAndAddOrdered(0);
+}
+
+/*!
+    \brief Returns the number of hedged requests that finished before the original request since the counters 
+    were last reset.
+
+    \sa Request::hedgingEnabled, resetCounters()
+*/
+int Network::hedgeWinCount() {
+    return hedgeWins.fetchAndAddOrdered(0);
+}
+
+/*!
+    \brief Resets the requestCount(), handshakeCount(), resumedHandshakeCount(), fullHandshakeCount(), 
+    redirectsSaved(), hedgeCount() and hedgeWinCount() to 0.
+*/
+void Network::resetCounters() {
+    requests.fetchAndStoreOrdered(0);
+    handshakes.fetchAndStoreOrdered(0);
+    resumedHandshakes.fetchAndStoreOrdered(0);
+    fullHandshakes.fetchAndStoreOrdered(0);
+    redirectsAvoided.fetchAndStoreOrdered(0);
+    hedges.fetchAndStoreOrdered(0);
+    hedgeWins.fetchAndStoreOrdered(0);
+}
+
+void Network::addReply(QNetworkReply *reply) {
+    if (reply->url().scheme() != "https") {
+        return;
+    }
+
+    requests.fetchAndAddOrdered(1);
+#if QT_VERSION >= 0x050100
+    connect(reply, &QNetworkReply::encrypted, &onReplyEncrypted);
+#endif
+}
+
+void Network::addLatency(const QString &host, int msecs) {
+    LatencyData *data = latencyData();
+    QMutexLocker locker(&data->mutex);
+    QList<int> &samples = data->samples[host];
+    samples.append(msecs);
+
+    if (samples.size() > MAX_LATENCY_SAMPLES) {
+        samples.removeFirst();
+    }
+}
+
+void Network::addProtocol(QNetworkReply *reply) {
+#if QT_VERSION >= 0x050900
+    const QString host = reply->url().host();
+    const bool multiplexed = reply->attribute(QNetworkRequest::Http2WasUsedAttribute).toBool();
+    ProtocolData *data = protocolData();
+    QMutexLocker locker(&data->mutex);
+
+    if (multiplexed) {
+        data->multiplexedHosts.insert(host);
+    }
+    else {
+        data->multiplexedHosts.remove(host);
+    }
+#else
+    Q_UNUSED(reply)
+#endif
+}
+
+void Network::addRedirect(const QUrl &url, const QUrl &target, bool allMethods) {
+    RedirectEntry *entry = new RedirectEntry;
+    entry->target = target;
+    entry->allMethods = allMethods;
+    RedirectData *data = redirectData();
+    QMutexLocker locker(&data->mutex);
+    data->entries.insert(url.toString(), entry);
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::Network::addRedirect" << url << target << allMethods;
+#endif
+}
+
+QUrl Network::redirectTarget(const QUrl &url, bool safeMethod) {
+    RedirectData *data = redirectData();
+    QMutexLocker locker(&data->mutex);
+    QUrl target = url;
+    int hops = 0;
+
+    while (hops < MAX_REDIRECT_HOPS) {
+        const RedirectEntry *entry = data->entries.object(target.toString());
+
+        if ((!entry) || ((!entry->allMethods) && (!safeMethod))) {
+            break;
+        }
+
+        target = entry->target;
+        hops++;
+    }
+
+    if (hops > 0) {
+        redirectsAvoided.fetchAndAddOrdered(hops);
+#ifdef QVIMEO_DEBUG
+        qDebug() << "QVimeo::Network::redirectTarget" << url << target << hops;
+#endif
+    }
+
+    return target;
+}
+
+void Network::setSslSession(QNetworkRequest *request) {
+#if QT_VERSION >= 0x050200
+    if ((request->url().scheme() != "https") || (!isSslSessionHost(request->url().host()))) {
+        return;
+    }
+
+    QSslConfiguration config = request->sslConfiguration();
+    // Persistence must be enabled for the session to be available once the handshake is done
+    config.setSslOption(QSsl::SslOptionDisableSessionPersistence, false);
+    SslSessionData *data = sslSessionData();
+    QMutexLocker locker(&data->mutex);
+
+    if (!data->loaded) {
+        data->load();
+    }
+
+    const QByteArray session = data->sessions.value(request->url().host());
+
+    if (!session.isEmpty()) {
+        config.setSessionTicket(session);
+    }
+
+    request->setSslConfiguration(config);
+#else
+    Q_UNUSED(request)
+#endif
+}
+
+void Network::addSslSession(QNetworkReply *reply) {
+#if QT_VERSION >= 0x050200
+    const QString host = reply->url().host();
+
+    if (!isSslSessionHost(host)) {
+        return;
+    }
+
+    const QByteArray offered = reply->request().sslConfiguration().sessionTicket();
+    const QByteArray session = reply->sslConfiguration().sessionTicket();
+
+    if ((!offered.isEmpty()) && (session == offered)) {
+        resumedHandshakes.fetchAndAddOrdered(1);
+    }
+    else {
+        fullHandshakes.fetchAndAddOrdered(1);
+    }
+
+    if (session.isEmpty()) {
+        return;
+    }
+
+    SslSessionData *data = sslSessionData();
+    QMutexLocker locker(&data->mutex);
+
+    if (session != data->sessions.value(host)) {
+        data->sessions[host] = session;
+        data->modified = true;
+        scheduleSslSessionSave(data);
+    }
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::Network::addSslSession" << host << (session == offered);
+#endif
+#else
+    Q_UNUSED(reply)
+#endif
+}
+
+void Network::addHedge(bool won) {
+    if (won) {
+        hedgeWins.fetchAndAddOrdered(1);
+    }
+    else {
+        hedges.fetchAndAddOrdered(1);
+    }
+}
+
+}
+
+#include "moc_network.cpp"
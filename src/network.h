@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QVIMEO_NETWORK_H
+#define QVIMEO_NETWORK_H
+
+#include "qvimeo_global.h"
+#include <QObject>
+#include <QString>
+
+class QNetworkAccessManager;
+class QNetworkReply;
+class QNetworkRequest;
+class QUrl;
+
+namespace QVimeo {
+
+class QVIMEOSHARED_EXPORT Network : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit Network(QObject *parent = 0);
+
+    static QNetworkAccessManager* networkAccessManager();
+
+    static void warmUp(QNetworkAccessManager *manager = 0);
+
+    Q_INVOKABLE void preconnect();
+
+    static int requestCount();
+    static int handshakeCount();
+    static int handshakesSaved();
+
+    static int latency(const QString &host, int percentile);
+
+    static bool isMultiplexed(const QString &host);
+
+    static QString sslSessionFileName();
+    static void setSslSessionFileName(const QString &fileName);
+
+    static int resumedHandshakeCount();
+    static int fullHandshakeCount();
+
+    static int redirectsSaved();
+    static void clearRedirects();
+
+    static int hedgeCount();
+    static int hedgeWinCount();
+
+    static void resetCounters();
+
+private:
+    static void addReply(QNetworkReply *reply);
+    static void addLatency(const QString &host, int msecs);
+    static void addProtocol(QNetworkReply *reply);
+    static void addHedge(bool won);
+    static void addRedirect(const QUrl &url, const QUrl &target, bool allMethods);
+    static QUrl redirectTarget(const QUrl &url, bool safeMethod);
+    static void setSslSession(QNetworkRequest *request);
+    static void addSslSession(QNetworkReply *reply);
+
+    friend class RequestPrivate;
+};
+
+}
+
+#endif // QVIMEO_NETWORK_H
@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ratelimit_p.h"
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QNetworkReply>
+#ifdef QVIMEO_DEBUG
+#include <QDebug>
+#endif
+
+namespace QVimeo {
+
+struct RateLimitWindow
+{
+    RateLimitWindow() :
+        limit(0),
+        remaining(0),
+        reset(0),
+        lastRequest(0)
+    {
+    }
+
+    int limit;
+    int remaining;
+    qint64 reset;
+    qint64 lastRequest;
+};
+
+struct RateLimitData
+{
+    QMutex mutex;
+    QHash<QString, RateLimitWindow> windows;
+};
+
+Q_GLOBAL_STATIC(RateLimitData, rateLimitData)
+
+// Parses the X-RateLimit-Reset header, which is either an ISO 8601 date or a number of seconds since the epoch
+static qint64 parseResetTime(const QByteArray &value) {
+    bool ok = false;
+    const qint64 seconds = value.toLongLong(&ok);
+
+    if (ok) {
+        return seconds * 1000;
+    }
+
+    QDateTime time = QDateTime::fromString(QString::fromLatin1(value.left(19)), Qt::ISODate);
+
+    if (!time.isValid()) {
+        return 0;
+    }
+
+    time.setTimeSpec(Qt::UTC);
+    const QByteArray offset = value.mid(19);
+
+    if ((offset.size() == 6) && ((offset.at(0) == '+') || (offset.at(0) == '-'))) {
+        const int secs = offset.mid(1, 2).toInt() * 3600 + offset.mid(4, 2).toInt() * 60;
+        time = time.addSecs(offset.at(0) == '+' ? -secs : secs);
+    }
+
+    return time.toMSecsSinceEpoch();
+}
+
+/*!
+    \class RateLimit
+    \brief Tracks the rate limits of the Vimeo Data API for each access token.
+
+    \ingroup requests
+
+    The Vimeo Data API reports the number of requests that may be made with an access token in the 
+    X-RateLimit-Limit, X-RateLimit-Remaining and X-RateLimit-Reset headers of each response. RateLimit records 
+    these, and Dispatcher uses delay() to spread its requests evenly over the rest of the rate limit window, so 
+    that the limit is not reached before the window resets. Retried and hedged requests are paced in the same 
+    way (see Request::setRetryPolicy() and Request::hedgingEnabled).
+
+    \sa Dispatcher
+*/
+
+/*!
+    \brief Returns the number of requests that may be made with \a accessToken in each rate limit window, or 
+    0 if it is not known.
+*/
+int RateLimit::limit(const QString &accessToken) {
+    RateLimitData *data = rateLimitData();
+    QMutexLocker locker(&data->mutex);
+
+    return data->windows.value(accessToken).limit;
+}
+
+/*!
+    \brief Returns the number of requests that may still be made with \a accessToken in the current rate limit 
+    window.
+
+    This includes requests that have been started but have not yet finished.
+*/
+int RateLimit::remaining(const QString &accessToken) {
+    RateLimitData *data = rateLimitData();
+    QMutexLocker locker(&data->mutex);
+
+    return data->windows.value(accessToken).remaining;
+}
+
+/*!
+    \brief Returns the time at which the current rate limit window for \a accessToken resets, or an invalid 
+    QDateTime if it is not known.
+*/
+QDateTime RateLimit::resetTime(const QString &accessToken) {
+    RateLimitData *data = rateLimitData();
+    QMutexLocker locker(&data->mutex);
+    const qint64 reset = data->windows.value(accessToken).reset;
+
+    return reset > 0 ? QDateTime::fromMSecsSinceEpoch(reset) : QDateTime();
+}
+
+/*!
+    \brief Returns the number of milliseconds to wait before the next request with \a accessToken.
+
+    The remaining requests are spread evenly until the rate limit window resets. If none remain, the delay lasts 
+    until the window resets. If the rate limit is not known, the delay is 0.
+*/
+int RateLimit::delay(const QString &accessToken) {
+    RateLimitData *data = rateLimitData();
+    QMutexLocker locker(&data->mutex);
+    QHash<QString, RateLimitWindow>::const_iterator iterator = data->windows.constFind(accessToken);
+
+    if (iterator == data->windows.constEnd()) {
+        return 0;
+    }
+
+    const RateLimitWindow &window = iterator.value();
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    if ((window.reset <= now) || (window.limit <= 0)) {
+        return 0;
+    }
+
+    if (window.remaining <= 0) {
+        return int(window.reset - now);
+    }
+
+    const qint64 interval = (window.reset - now) / window.remaining;
+
+    return int(qMax(qint64(0), window.lastRequest + interval - now));
+}
+
+void RateLimitPrivate::update(const QString &accessToken, QNetworkReply *reply) {
+    const bool limited = (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 429);
+
+    if ((!limited) && (!reply->hasRawHeader("X-RateLimit-Limit"))) {
+        return;
+    }
+
+    RateLimitData *data = rateLimitData();
+    QMutexLocker locker(&data->mutex);
+    RateLimitWindow &window = data->windows[accessToken];
+
+    if (reply->hasRawHeader("X-RateLimit-Limit")) {
+        window.limit = reply->rawHeader("X-RateLimit-Limit").toInt();
+        window.remaining = reply->rawHeader("X-RateLimit-Remaining").toInt();
+        window.reset = parseResetTime(reply->rawHeader("X-RateLimit-Reset"));
+    }
+
+    if (limited) {
+        window.remaining = 0;
+    }
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::RateLimitPrivate::update" << window.limit << window.remaining << window.reset;
+#endif
+}
+
+void RateLimitPrivate::addRequest(const QString &accessToken) {
+    RateLimitData *data = rateLimitData();
+    QMutexLocker locker(&data->mutex);
+    QHash<QString, RateLimitWindow>::iterator iterator = data->windows.find(accessToken);
+
+    if (iterator != data->windows.end()) {
+        iterator.value().lastRequest = QDateTime::currentMSecsSinceEpoch();
+
+        if (iterator.value().remaining > 0) {
+            iterator.value().remaining--;
+        }
+    }
+}
+
+}
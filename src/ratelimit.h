@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QVIMEO_RATELIMIT_H
+#define QVIMEO_RATELIMIT_H
+
+#include "qvimeo_global.h"
+#include <QDateTime>
+#include <QString>
+
+namespace QVimeo {
+
+class QVIMEOSHARED_EXPORT RateLimit
+{
+
+public:
+    static int limit(const QString &accessToken);
+    static int remaining(const QString &accessToken);
+    static QDateTime resetTime(const QString &accessToken);
+
+    static int delay(const QString &accessToken);
+};
+
+}
+
+#endif // QVIMEO_RATELIMIT_H
@@ -15,14 +15,33 @@
  */
 
 #include "request_p.h"
+#include "network.h"
+#include "ratelimit_p.h"
 #include "urls.h"
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QBuffer>
+#include <QDateTime>
+#include <QHash>
+#include <QLocale>
+#include <QThreadStorage>
+#include <QTimer>
 #include <QDebug>
+#include <zlib.h>
 
 namespace QVimeo {
 
+// GET requests in progress in each thread, by RequestPrivate::inFlightKey
+static QThreadStorage<QHash<QString, Request*>*> inFlightStorage;
+
+static QHash<QString, Request*>* inFlightRequests() {
+    if (!inFlightStorage.hasLocalData()) {
+        inFlightStorage.setLocalData(new QHash<QString, Request*>);
+    }
+    
+    return inFlightStorage.localData();
+}
+
 /*!
     \class Request
     \brief The base class for making requests to the Vimeo Data API.
@@ -31,6 +50,15 @@ namespace QVimeo {
     
     Normally, there should be no need to use this class, but it can be useful if you need to extend the range of API 
     requests beyond those provided in the existing subclasses.   
+    
+    When a GET request is made while an identical one is already in progress in the same thread, no further 
+    network request is made. Instead, the later request receives the same result when the first one finishes. 
+    If the first request is canceled or deleted, the later one continues on its own.
+    
+    When the response is parsed incrementally, a request only joins one that has not yet emitted any 
+    itemsReady() signals, and then emits the same items. If the first request is canceled or deleted after 
+    items have been emitted, the later one fails with OperationCanceledError, rather than emitting the same 
+    items again.
 */
 Request::Request(QObject *parent) :
     QObject(parent),
@@ -47,10 +75,19 @@ Request::Request(RequestPrivate &dd, QObject *parent) :
 Request::~Request() {
     Q_D(Request);
     
+    if ((!d->inFlightKey.isEmpty()) && (inFlightRequests()->value(d->inFlightKey) == this)) {
+        inFlightRequests()->remove(d->inFlightKey);
+    }
+    
     if (d->reply) {
         delete d->reply;
         d->reply = 0;
     }
+    
+    if (d->hedgeReply) {
+        delete d->hedgeReply;
+        d->hedgeReply = 0;
+    }
 }
 
 /*!
@@ -321,13 +358,62 @@ Request::Status Request::status() const {
 /*!
     \property QVariant Request::result
     \brief The result of the last HTTP request.
+    
+    When compactResult is enabled, the result is converted from resultDocument() the first time it is read.
 */
 QVariant Request::result() const {
     Q_D(const Request);
     
+    if (d->resultPending) {
+        d->result = d->document.toVariant();
+        d->resultPending = false;
+    }
+    
     return d->result;
 }
 
+/*!
+    \brief Returns the result of the last HTTP request as a compact document.
+    
+    The document is only available when compactResult is enabled. Otherwise, a null document is returned.
+    
+    The values of the document share its data, so they can be kept after the document is destroyed, for 
+    example:
+    
+    \code
+    QtJson::JsonValue video = request->resultDocument().value("/data/0");
+    QString name = video.value("name").toString();
+    \endcode
+    
+    \sa compactResult
+*/
+QtJson::JsonDocument Request::resultDocument() const {
+    Q_D(const Request);
+    
+    return d->document;
+}
+
+/*!
+    \brief Returns the value at \a pointer in the result of the last HTTP request.
+    
+    \a pointer is a JSON Pointer, such as "/data/3/pictures/sizes/2/link". An invalid QVariant is returned if 
+    there is no value at \a pointer.
+    
+    When compactResult is enabled, only the value at \a pointer is decoded from the response, so reading a few 
+    values from a large response does not require the whole result to be built.
+    
+    \sa compactResult, resultDocument()
+*/
+QVariant Request::resultValue(const QString &pointer) const {
+    Q_D(const Request);
+    
+    if (!d->document.isNull()) {
+        return d->document.value(pointer).toVariant();
+    }
+    
+    return QtJson::Json::pointerValue(d->result, pointer);
+}
+
 /*!
     \enum Request::Error
     \brief The error resulting from the last HTTP request.
@@ -449,6 +535,10 @@ QVariant Request::result() const {
             <td>ParseError</td>
             <td>There was an error in parsing the server response.</td>
         </tr>
+        <tr>
+            <td>RequestTimeoutError</td>
+            <td>The request did not finish within the timeout, or no data was received within the readTimeout.</td>
+        </tr>
     </table>
 */
 
@@ -473,392 +563,1312 @@ QString Request::errorString() const {
 }
 
 /*!
-    \brief Sets the QNetworkAccessManager instance to be used 
-    when making requests to the Vimeo API.
+    \property bool Request::incrementalParsing
+    \brief Whether the response is parsed as it is received.
     
-    Request does not take ownership of \a manager.
+    When enabled, each chunk of the response is parsed as soon as it arrives, so that parsing overlaps the 
+    download and finished() is emitted shortly after the last byte is received.
     
-    If no QNetworkAccessManager is set, one will be created 
-    when required.    
+    This has no effect for requests that process the response themselves, such as AuthenticationRequest and 
+    StreamsRequest.
+    
+    The default is false.
 */
-void Request::setNetworkAccessManager(QNetworkAccessManager *manager) {
+
+/*!
+    \fn void Request::incrementalParsingChanged()
+    \brief Emitted when incrementalParsing changes.
+*/
+bool Request::incrementalParsing() const {
+    Q_D(const Request);
+    
+    return d->incrementalParsing;
+}
+
+void Request::setIncrementalParsing(bool enabled) {
     Q_D(Request);
     
-    if ((d->manager) && (d->ownNetworkAccessManager)) {
-        delete d->manager;
+    if (enabled != d->incrementalParsing) {
+        d->incrementalParsing = enabled;
+        emit incrementalParsingChanged();
     }
-    
-    d->ownNetworkAccessManager = false;
-    d->manager = manager;
 #ifdef QVIMEO_DEBUG
-    qDebug() << "QVimeo::Request::setNetworkAccessManager" << manager;
+    qDebug() << "QVimeo::Request::setIncrementalParsing" << enabled;
 #endif
 }
 
 /*!
-    \brief Performs a HTTP HEAD request.
-*/
-void Request::head(bool authRequired) {
-    Q_D(Request);
+    \property QString Request::itemsKey
+    \brief The key of the array in the response whose items are reported as they are parsed.
     
-    if (d->url.isEmpty()) {
-        qDebug() << "QVimeo::Request::head(): URL is empty";
-        return;
-    }
-    
-    d->redirects = 0;
-    d->setOperation(HeadOperation);
-    d->setStatus(Loading);
+    When incrementalParsing is enabled and itemsKey is set, itemsReady() is emitted with each batch of items 
+    from the array at itemsKey in the top level response object as soon as they have been parsed. The items are 
+    also included in the result.
     
-    if (d->reply) {
-        delete d->reply;
-    }
-#ifdef QVIMEO_DEBUG
-    qDebug() << "QVimeo::Request::head" << d->url;
-#endif
-    d->reply = d->networkAccessManager()->head(d->buildRequest(authRequired));
-    connect(d->reply, SIGNAL(finished()), this, SLOT(_q_onReplyFinished()));
-}
+    For example, set itemsKey to "data" to receive the resources of a list request while the response is still 
+    being downloaded.
+*/
 
 /*!
-    \brief Performs a HTTP GET request.
+    \fn void Request::itemsKeyChanged()
+    \brief Emitted when the itemsKey changes.
 */
-void Request::get(bool authRequired) {
-    Q_D(Request);
+
+/*!
+    \fn void Request::itemsReady(const QVariantList &items)
+    \brief Emitted when \a items have been parsed from the array at itemsKey.
     
-    if (d->url.isEmpty()) {
-        qDebug() << "QVimeo::Request::get(): URL is empty";
-        return;
-    }
+    \sa incrementalParsing
+*/
+QString Request::itemsKey() const {
+    Q_D(const Request);
     
-    d->redirects = 0;
-    d->setOperation(GetOperation);
-    d->setStatus(Loading);
+    return d->parser.elementsKey();
+}
+
+void Request::setItemsKey(const QString &key) {
+    Q_D(Request);
     
-    if (d->reply) {
-        delete d->reply;
+    if (key != d->parser.elementsKey()) {
+        d->parser.setElementsKey(key);
+        emit itemsKeyChanged();
     }
 #ifdef QVIMEO_DEBUG
-    qDebug() << "QVimeo::Request::get" << d->url;
+    qDebug() << "QVimeo::Request::setItemsKey" << key;
 #endif
-    d->reply = d->networkAccessManager()->get(d->buildRequest(authRequired));
-    connect(d->reply, SIGNAL(finished()), this, SLOT(_q_onReplyFinished()));
 }
 
 /*!
-    \brief Performs a HTTP POST request.
-*/
-void Request::post(bool authRequired) {
-    Q_D(Request);
+    \property QStringList Request::projection
+    \brief The key paths of the response that are kept in the result.
     
-    if (d->url.isEmpty()) {
-        qDebug() << "QVimeo::Request::post(): URL is empty";
-        return;
-    }
+    When projection is set, only the values at the given key paths are included in the result. Everything else 
+    is skipped while the response is parsed, without being decoded, which reduces both the parsing time and 
+    the memory used by large responses. Each path is a list of keys separated by periods, and arrays are 
+    transparent, so "data.pictures.sizes.link" (or "data.pictures.sizes[*].link") keeps the link of each 
+    picture size of each resource.
     
-    d->redirects = 0;
-    d->setOperation(PostOperation);
+    The projection is only applied to successful (2xx) responses. Error responses are kept in full, so that 
+    the error details from the server remain available in the result.
     
-    bool ok = true;
-    QByteArray data;
+    Changes take effect from the next request. The default is an empty list, meaning the whole response is kept.
+*/
+
+/*!
+    \fn void Request::projectionChanged()
+    \brief Emitted when the projection changes.
+*/
+QStringList Request::projection() const {
+    Q_D(const Request);
     
-    switch (d->data.type()) {
-    case QVariant::String:
-    case QVariant::ByteArray:
-    case QVariant::Invalid:
-        data = d->data.toString().toUtf8();
-        break;
-    default:
-        data = QtJson::Json::serialize(d->data, ok);
-        break;
+    return d->projection.paths();
+}
+
+void Request::setProjection(const QStringList &paths) {
+    Q_D(Request);
+    
+    if (paths != d->projection.paths()) {
+        d->projection = QtJson::JsonProjection(paths);
+        emit projectionChanged();
     }
 #ifdef QVIMEO_DEBUG
-    qDebug() << "QVimeo::Request::post" << d->url << data;
+    qDebug() << "QVimeo::Request::setProjection" << paths;
 #endif
-    if (ok) {
-        if (d->reply) {
-            delete d->reply;
-        }
-        
-        d->setStatus(Loading);        
-        d->reply = d->networkAccessManager()->post(d->buildRequest(authRequired), data);
-        connect(d->reply, SIGNAL(finished()), this, SLOT(_q_onReplyFinished()));
-    }
-    else {
-        d->setStatus(Failed);
-        d->setError(ParseError);
-        d->setErrorString(tr("Unable to serialize the POST data"));
-        emit finished();
-    }    
 }
 
 /*!
-    \brief Performs a HTTP PUT request.
-*/
-void Request::put(bool authRequired) {
-    Q_D(Request);
+    \property bool Request::compactResult
+    \brief Whether the response is kept as a compact document.
     
-    if (d->url.isEmpty()) {
-        qDebug() << "QVimeo::Request::put(): URL is empty";
-        return;
-    }
+    When enabled, the response is parsed into a QtJson::JsonDocument, which stores its values contiguously and 
+    only decodes strings when they are accessed, and is available from resultDocument(). The QVariant result is 
+    only built if it is read. This is useful for C++ callers that read a few values from large responses.
     
-    d->redirects = 0;
-    d->setOperation(PutOperation);
+    This has no effect when the response is parsed incrementally, and the projection is not applied to the 
+    document.
     
-    bool ok = true;
-    QByteArray data;
+    The default is false.
     
-    switch (d->data.type()) {
-    case QVariant::String:
-    case QVariant::ByteArray:
-    case QVariant::Invalid:
-        data = d->data.toString().toUtf8();
-        break;
-    default:
-        data = QtJson::Json::serialize(d->data, ok);
-        break;
+    \sa resultDocument()
+*/
+
+/*!
+    \fn void Request::compactResultChanged()
+    \brief Emitted when compactResult changes.
+*/
+bool Request::compactResult() const {
+    Q_D(const Request);
+    
+    return d->compactResult;
+}
+
+void Request::setCompactResult(bool enabled) {
+    Q_D(Request);
+    
+    if (enabled != d->compactResult) {
+        d->compactResult = enabled;
+        emit compactResultChanged();
     }
 #ifdef QVIMEO_DEBUG
-    qDebug() << "QVimeo::Request::put" << d->url << data;
+    qDebug() << "QVimeo::Request::setCompactResult" << enabled;
 #endif
-    if (ok) {
-        if (d->reply) {
-            delete d->reply;
-        }
-        
-        d->setStatus(Loading);        
-        d->reply = d->networkAccessManager()->put(d->buildRequest(authRequired), data);
-        connect(d->reply, SIGNAL(finished()), this, SLOT(_q_onReplyFinished()));
-    }
-    else {
-        d->setStatus(Failed);
-        d->setError(ParseError);
-        d->setErrorString(tr("Unable to serialize the PUT data"));
-        emit finished();
-    }    
 }
 
 /*!
-    \brief Performs a HTTP PATCH request.
-*/
-void Request::patch(bool authRequired) {
-    Q_D(Request);
+    \property bool Request::cacheEnabled
+    \brief Whether the results of GET requests are cached and revalidated.
     
-    if (d->url.isEmpty()) {
-        qDebug() << "QVimeo::Request::patch(): URL is empty";
-        return;
-    }
+    When enabled, the result of each successful GET request is stored in the Cache. Subsequent GET requests for 
+    the same URL use the stored result without making a network request while it is younger than 
+    Cache::timeToLive(). After that, they include If-None-Match and If-Modified-Since headers, and if the server 
+    responds with 304 Not Modified, the stored result is used without being downloaded or parsed again.
     
-    d->redirects = 0;
-    d->setOperation(PatchOperation);    
+    This has no effect for requests that process the response themselves, such as AuthenticationRequest and 
+    StreamsRequest.
     
-    bool ok = true;
-    QByteArray data;
+    The default is false.
     
-    switch (d->data.type()) {
-    case QVariant::String:
-    case QVariant::ByteArray:
-    case QVariant::Invalid:
-        data = d->data.toString().toUtf8();
-        break;
-    default:
-        data = QtJson::Json::serialize(d->data, ok);
-        break;
-    }
-#ifdef QVIMEO_DEBUG
-    qDebug() << "QVimeo::Request::patch" << d->url << data;
-#endif
-    if (ok) {
-        d->setStatus(Loading);        
-        
-        if (!d->buffer) {
-            d->buffer = new QBuffer(this);
-        }
-        
-        if (d->buffer->isOpen()) {
-            d->buffer->close();
-        }
-        
-        d->buffer->setData(data);
-        
-        if (d->buffer->open(QBuffer::ReadOnly)) {
-            if (d->reply) {
-                delete d->reply;
-            }
-            
-            d->reply = d->networkAccessManager()->sendCustomRequest(d->buildRequest(authRequired), "PATCH", d->buffer);
-            connect(d->reply, SIGNAL(finished()), this, SLOT(_q_onReplyFinished()));
-        }
-        else {
-            d->setStatus(Failed);
-            d->setError(UnknownContentError);
-            d->setErrorString(d->buffer->errorString());
-        }
-    }
-    else {
-        d->setStatus(Failed);
-        d->setError(ParseError);
-        d->setErrorString(tr("Unable to serialize the PATCH data"));
-        emit finished();
-    }
-}
+    \sa Cache
+*/
 
 /*!
-    \brief Performs a HTTP DELETE request.
+    \fn void Request::cacheEnabledChanged()
+    \brief Emitted when cacheEnabled changes.
 */
-void Request::deleteResource(bool authRequired) {
-    Q_D(Request);
-    
-    if (d->url.isEmpty()) {
-        qDebug() << "QVimeo::Request::deleteResource(): URL is empty";
-        return;
-    }
+bool Request::cacheEnabled() const {
+    Q_D(const Request);
     
-    d->redirects = 0;
-    d->setOperation(DeleteOperation);
-    d->setStatus(Loading);
+    return d->cacheEnabled;
+}
+
+void Request::setCacheEnabled(bool enabled) {
+    Q_D(Request);
     
-    if (d->reply) {
-        delete d->reply;
+    if (enabled != d->cacheEnabled) {
+        d->cacheEnabled = enabled;
+        emit cacheEnabledChanged();
     }
 #ifdef QVIMEO_DEBUG
-    qDebug() << "QVimeo::Request::deleteResource" << d->url;
+    qDebug() << "QVimeo::Request::setCacheEnabled" << enabled;
 #endif
-    d->reply = d->networkAccessManager()->deleteResource(d->buildRequest(authRequired));
-    connect(d->reply, SIGNAL(finished()), this, SLOT(_q_onReplyFinished()));
 }
 
 /*!
-    \brief Cancels the current HTTP request.
+    \property int Request::timeout
+    \brief The maximum time in milliseconds that a request may take.
+    
+    If the request has not finished within the timeout, including any redirects and retries, it is aborted and 
+    fails with RequestTimeoutError.
+    
+    Changes take effect from the next request. The default is 0, meaning no timeout.
 */
-void Request::cancel() {
+
+/*!
+    \fn void Request::timeoutChanged()
+    \brief Emitted when the timeout changes.
+*/
+int Request::timeout() const {
+    Q_D(const Request);
+    
+    return d->timeout;
+}
+
+void Request::setTimeout(int msecs) {
     Q_D(Request);
     
-    if (d->reply) {
-        d->reply->abort();
+    msecs = qMax(0, msecs);
+    
+    if (msecs != d->timeout) {
+        d->timeout = msecs;
+        emit timeoutChanged();
     }
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::Request::setTimeout" << msecs;
+#endif
 }
 
-RequestPrivate::RequestPrivate(Request *parent) :
+/*!
+    \property int Request::readTimeout
+    \brief The maximum time in milliseconds to wait for data from the server.
+    
+    If no data is sent or received for longer than the readTimeout, for example because the connection has 
+    stalled, the request is aborted and fails with RequestTimeoutError.
+    
+    Changes take effect from the next request. The default is 0, meaning no timeout.
+*/
+
+/*!
+    \fn void Request::readTimeoutChanged()
+    \brief Emitted when the readTimeout changes.
+*/
+int Request::readTimeout() const {
+    Q_D(const Request);
+    
+    return d->readTimeout;
+}
+
+void Request::setReadTimeout(int msecs) {
+    Q_D(Request);
+    
+    msecs = qMax(0, msecs);
+    
+    if (msecs != d->readTimeout) {
+        d->readTimeout = msecs;
+        emit readTimeoutChanged();
+    }
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::Request::setReadTimeout" << msecs;
+#endif
+}
+
+/*!
+    \property qint64 Request::bytesReceived
+    \brief The number of bytes of the last response that were received from the network.
+    
+    The response is requested with gzip or deflate compression, so this is normally smaller than the 
+    responseSize.
+*/
+qint64 Request::bytesReceived() const {
+    Q_D(const Request);
+    
+    return d->bytesReceived;
+}
+
+/*!
+    \property qint64 Request::responseSize
+    \brief The number of bytes of the last response after it was decompressed.
+*/
+qint64 Request::responseSize() const {
+    Q_D(const Request);
+    
+    return d->responseSize;
+}
+
+/*!
+    \property bool Request::hedgingEnabled
+    \brief Whether a second GET or HEAD request is sent when the response is slow.
+    
+    When enabled, if a GET or HEAD request has not finished within the time in which hedgingPercentile percent 
+    of recent requests to the same host finished, an identical request is sent. Whichever finishes first is 
+    used, and the other is aborted. This reduces the effect of an occasional slow connection on latency, at 
+    the cost of a small number of extra requests.
+    
+    Until there have been enough requests to the host to measure their response times, a delay of 1 second is 
+    used. A second request is not sent once items have been reported by itemsReady(), nor to the Vimeo Data 
+    API when the next request would be delayed by the RateLimit, or less than 10 percent of it remains. The 
+    second request counts towards the RateLimit.
+    
+    The default is false.
+    
+    \sa Network::hedgeCount(), Network::hedgeWinCount()
+*/
+
+/*!
+    \fn void Request::hedgingEnabledChanged()
+    \brief Emitted when hedgingEnabled changes.
+*/
+bool Request::hedgingEnabled() const {
+    Q_D(const Request);
+    
+    return d->hedgingEnabled;
+}
+
+void Request::setHedgingEnabled(bool enabled) {
+    Q_D(Request);
+    
+    if (enabled != d->hedgingEnabled) {
+        d->hedgingEnabled = enabled;
+        emit hedgingEnabledChanged();
+    }
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::Request::setHedgingEnabled" << enabled;
+#endif
+}
+
+/*!
+    \property int Request::hedgingPercentile
+    \brief The percentile of recent response times after which a second request is sent.
+    
+    The default is 95.
+    
+    \sa hedgingEnabled
+*/
+
+/*!
+    \fn void Request::hedgingPercentileChanged()
+    \brief Emitted when the hedgingPercentile changes.
+*/
+int Request::hedgingPercentile() const {
+    Q_D(const Request);
+    
+    return d->hedgingPercentile;
+}
+
+void Request::setHedgingPercentile(int percentile) {
+    Q_D(Request);
+    
+    percentile = qBound(1, percentile, 100);
+    
+    if (percentile != d->hedgingPercentile) {
+        d->hedgingPercentile = percentile;
+        emit hedgingPercentileChanged();
+    }
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::Request::setHedgingPercentile" << percentile;
+#endif
+}
+
+/*!
+    \brief Returns the policy that determines whether and when failed requests are retried.
+    
+    The default policy does not retry.
+    
+    \sa setRetryPolicy()
+*/
+RetryPolicy Request::retryPolicy() const {
+    Q_D(const Request);
+    
+    return d->retryPolicy;
+}
+
+/*!
+    \brief Sets the policy that determines whether and when failed requests are retried to \a policy.
+    
+    While a request is waiting to be retried, its status remains Loading, and finished() is only emitted once 
+    it succeeds or can no longer be retried. Retries of requests to the Vimeo Data API wait at least until the 
+    RateLimit allows the next request, and count towards it.
+    
+    \sa RetryPolicy
+*/
+void Request::setRetryPolicy(const RetryPolicy &policy) {
+    Q_D(Request);
+    
+    d->retryPolicy = policy;
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::Request::setRetryPolicy" << policy.maximumRetries();
+#endif
+}
+
+/*!
+    \brief Sets the QNetworkAccessManager instance to be used 
+    when making requests to the Vimeo API.
+    
+    Request does not take ownership of \a manager.
+    
+    If no QNetworkAccessManager is set, the one returned by 
+    Network::networkAccessManager() is used, so that connections 
+    are shared with other requests.
+*/
+void Request::setNetworkAccessManager(QNetworkAccessManager *manager) {
+    Q_D(Request);
+    
+    d->manager = manager;
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::Request::setNetworkAccessManager" << manager;
+#endif
+}
+
+/*!
+    \brief Performs a HTTP HEAD request.
+*/
+void Request::head(bool authRequired) {
+    Q_D(Request);
+    
+    if (d->url.isEmpty()) {
+        qDebug() << "QVimeo::Request::head(): URL is empty";
+        return;
+    }
+    
+    d->redirects = 0;
+    d->retries = 0;
+    d->detachFromLeader();
+    d->setOperation(HeadOperation);
+    d->setStatus(Loading);
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::Request::head" << d->url;
+#endif
+    d->sendRequest(d->buildRequest(authRequired), "HEAD");
+}
+
+/*!
+    \brief Performs a HTTP GET request.
+*/
+void Request::get(bool authRequired) {
+    Q_D(Request);
+    
+    if (d->url.isEmpty()) {
+        qDebug() << "QVimeo::Request::get(): URL is empty";
+        return;
+    }
+    
+    d->redirects = 0;
+    d->retries = 0;
+    d->authRequired = authRequired;
+    d->stopRetry();
+    d->detachFromLeader();
+    d->setOperation(GetOperation);
+    d->setStatus(Loading);
+    
+    if (d->reply) {
+        delete d->reply;
+        d->reply = 0;
+    }
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::Request::get" << d->url;
+#endif
+    if ((d->cacheEnabled) && (d->canCacheResult())) {
+        CacheEntry entry;
+        d->cacheKey = d->cacheKeyForUrl(d->url);
+        
+        if ((CachePrivate::find(d->cacheKey, &entry)) && (CachePrivate::isFresh(entry))) {
+            // Finish asynchronously, as if the result had been received from the network
+            d->cacheHitPending = true;
+            QMetaObject::invokeMethod(this, "_q_loadCachedResult", Qt::QueuedConnection);
+            return;
+        }
+    }
+    
+    d->startGet();
+}
+
+/*!
+    \brief Performs a HTTP POST request.
+*/
+void Request::post(bool authRequired) {
+    Q_D(Request);
+    
+    if (d->url.isEmpty()) {
+        qDebug() << "QVimeo::Request::post(): URL is empty";
+        return;
+    }
+    
+    d->redirects = 0;
+    d->retries = 0;
+    d->detachFromLeader();
+    d->setOperation(PostOperation);
+    
+    bool ok = true;
+    QByteArray data;
+    
+    switch (d->data.type()) {
+    case QVariant::String:
+    case QVariant::ByteArray:
+    case QVariant::Invalid:
+        data = d->data.toString().toUtf8();
+        break;
+    default:
+        data = QtJson::Json::serialize(d->data, ok);
+        break;
+    }
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::Request::post" << d->url << data;
+#endif
+    if (ok) {
+        d->setStatus(Loading);
+        d->sendRequest(d->buildRequest(authRequired), "POST", data);
+    }
+    else {
+        d->setStatus(Failed);
+        d->setError(ParseError);
+        d->setErrorString(tr("Unable to serialize the POST data"));
+        emit finished();
+    }    
+}
+
+/*!
+    \brief Performs a HTTP PUT request.
+*/
+void Request::put(bool authRequired) {
+    Q_D(Request);
+    
+    if (d->url.isEmpty()) {
+        qDebug() << "QVimeo::Request::put(): URL is empty";
+        return;
+    }
+    
+    d->redirects = 0;
+    d->retries = 0;
+    d->detachFromLeader();
+    d->setOperation(PutOperation);
+    
+    bool ok = true;
+    QByteArray data;
+    
+    switch (d->data.type()) {
+    case QVariant::String:
+    case QVariant::ByteArray:
+    case QVariant::Invalid:
+        data = d->data.toString().toUtf8();
+        break;
+    default:
+        data = QtJson::Json::serialize(d->data, ok);
+        break;
+    }
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::Request::put" << d->url << data;
+#endif
+    if (ok) {
+        d->setStatus(Loading);
+        d->sendRequest(d->buildRequest(authRequired), "PUT", data);
+    }
+    else {
+        d->setStatus(Failed);
+        d->setError(ParseError);
+        d->setErrorString(tr("Unable to serialize the PUT data"));
+        emit finished();
+    }    
+}
+
+/*!
+    \brief Performs a HTTP PATCH request.
+*/
+void Request::patch(bool authRequired) {
+    Q_D(Request);
+    
+    if (d->url.isEmpty()) {
+        qDebug() << "QVimeo::Request::patch(): URL is empty";
+        return;
+    }
+    
+    d->redirects = 0;
+    d->retries = 0;
+    d->detachFromLeader();
+    d->setOperation(PatchOperation);    
+    
+    bool ok = true;
+    QByteArray data;
+    
+    switch (d->data.type()) {
+    case QVariant::String:
+    case QVariant::ByteArray:
+    case QVariant::Invalid:
+        data = d->data.toString().toUtf8();
+        break;
+    default:
+        data = QtJson::Json::serialize(d->data, ok);
+        break;
+    }
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::Request::patch" << d->url << data;
+#endif
+    if (ok) {
+        d->setStatus(Loading);
+        d->sendRequest(d->buildRequest(authRequired), "PATCH", data);
+    }
+    else {
+        d->setStatus(Failed);
+        d->setError(ParseError);
+        d->setErrorString(tr("Unable to serialize the PATCH data"));
+        emit finished();
+    }
+}
+
+/*!
+    \brief Performs a HTTP DELETE request.
+*/
+void Request::deleteResource(bool authRequired) {
+    Q_D(Request);
+    
+    if (d->url.isEmpty()) {
+        qDebug() << "QVimeo::Request::deleteResource(): URL is empty";
+        return;
+    }
+    
+    d->redirects = 0;
+    d->retries = 0;
+    d->detachFromLeader();
+    d->setOperation(DeleteOperation);
+    d->setStatus(Loading);
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::Request::deleteResource" << d->url;
+#endif
+    d->sendRequest(d->buildRequest(authRequired), "DELETE");
+}
+
+/*!
+    \brief Cancels the current HTTP request.
+*/
+void Request::cancel() {
+    Q_D(Request);
+    
+    if (d->reply) {
+        d->reply->abort();
+    }
+    else if ((d->cacheHitPending) || (d->retryPending) || (d->leader)) {
+        d->cacheHitPending = false;
+        d->stopRetry();
+        d->detachFromLeader();
+        d->setCanceled();
+        emit finished();
+    }
+}
+
+RequestPrivate::RequestPrivate(Request *parent) :
     q_ptr(parent),
     manager(0),
     reply(0),
-    buffer(0),
-    ownNetworkAccessManager(false),
     operation(Request::UnknownOperation),
     status(Request::Null),
     error(Request::NoError),
-    redirects(0)
+    redirects(0),
+    resultPending(false),
+    incrementalParsing(false),
+    incrementalReply(false),
+    compactResult(false),
+    compactReply(false),
+    cacheEnabled(false),
+    cacheHitPending(false),
+    responseSize(0),
+    authRequired(true),
+    retries(0),
+    retryPending(false),
+    itemsEmitted(false),
+    timeout(0),
+    readTimeout(0),
+    timeoutTimer(0),
+    readTimer(0),
+    retryTimer(0),
+    timedOut(false),
+    hedgingEnabled(false),
+    hedgingPercentile(DEFAULT_HEDGING_PERCENTILE),
+    hedgeTimer(0),
+    hedgeReply(0),
+    bytesReceived(0),
+    encoding(UnknownEncoding),
+    inflater(0)
 {
 }
 
-RequestPrivate::~RequestPrivate() {}
+RequestPrivate::~RequestPrivate() {
+    if (inflater) {
+        inflateEnd(inflater);
+        delete inflater;
+    }
+}
 
 QNetworkAccessManager* RequestPrivate::networkAccessManager() {    
-    if (!manager) {
+    return manager ? manager : Network::networkAccessManager();
+}
+
+void RequestPrivate::setOperation(Request::Operation op) {
+    if (op != operation) {
+        Q_Q(Request);
+        operation = op;
+        emit q->operationChanged();
+    }
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::RequestPrivate::setOperation " << Request::Operation(op);
+#endif
+}
+
+void RequestPrivate::setStatus(Request::Status s) {
+    if (s != status) {
+        Q_Q(Request);
+        
+        if (s == Request::Loading) {
+            timedOut = false;
+            
+            if (timeout > 0) {
+                startTimer(&timeoutTimer, timeout, SLOT(_q_onTimeout()));
+            }
+        }
+        else {
+            stopTimers();
+            cancelHedge();
+            // Removed before finished() is emitted, so that the followers of a canceled request do not rejoin it
+            leaveInFlight();
+        }
+        
+        status = s;
+        emit q->statusChanged(s);
+    }
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::RequestPrivate::setStatus " << Request::Status(s);
+#endif
+}
+
+void RequestPrivate::setCanceled() {
+    if (timedOut) {
+        setStatus(Request::Failed);
+        setError(Request::RequestTimeoutError);
+        setErrorString(Request::tr("The request timed out"));
+    }
+    else {
+        setStatus(Request::Canceled);
+        setError(Request::NoError);
+        setErrorString(QString());
+    }
+}
+
+void RequestPrivate::startTimer(QTimer **timer, int msecs, const char *slot) {
+    if (!*timer) {
+        Q_Q(Request);
+        *timer = new QTimer(q);
+        (*timer)->setSingleShot(true);
+        Request::connect(*timer, SIGNAL(timeout()), q, slot);
+    }
+    
+    (*timer)->start(msecs);
+}
+
+void RequestPrivate::stopTimers() {
+    if (timeoutTimer) {
+        timeoutTimer->stop();
+    }
+    
+    if (readTimer) {
+        readTimer->stop();
+    }
+}
+
+void RequestPrivate::stopRetry() {
+    retryPending = false;
+    
+    if (retryTimer) {
+        retryTimer->stop();
+    }
+}
+
+void RequestPrivate::setError(Request::Error e) {
+    error = e;
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::RequestPrivate::setError " << Request::Error(e);
+#endif
+}
+
+void RequestPrivate::setErrorString(const QString &es) {
+    errorString = es;
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::RequestPrivate::setErrorString " << es;
+#endif
+}
+
+void RequestPrivate::setResult(const QVariant &res) {
+    result = res;
+    resultPending = false;
+    document = QtJson::JsonDocument();
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::RequestPrivate::setResult " << res;
+#endif
+}
+
+void RequestPrivate::setResultDocument(const QtJson::JsonDocument &doc) {
+    result = QVariant();
+    resultPending = !doc.isNull();
+    document = doc;
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::RequestPrivate::setResultDocument";
+#endif
+}
+
+void RequestPrivate::setCachedResult(const CacheEntry &entry) {
+    if (entry.document.isNull()) {
+        setResult(entry.result);
+    }
+    else {
+        setResultDocument(entry.document);
+    }
+    
+    if ((incrementalReply) && (!parser.elementsKey().isEmpty())) {
+        const QVariantList items = result.toMap().value(parser.elementsKey()).toList();
+        
+        if (!items.isEmpty()) {
+            Q_Q(Request);
+            emit q->itemsReady(items);
+        }
+    }
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::RequestPrivate::setCachedResult" << entry.etag << entry.lastModified;
+#endif
+}
+
+QNetworkRequest RequestPrivate::buildRequest(bool authRequired) {
+    return buildRequest(url, authRequired);
+}
+
+QNetworkRequest RequestPrivate::buildRequest(QUrl u, bool authRequired) {
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::RequestPrivate::buildRequest " << u;
+#endif
+    // Go straight to the location of a resource that has been permanently moved
+    const bool safeMethod = (operation == Request::GetOperation) || (operation == Request::HeadOperation);
+    QNetworkRequest request(Network::redirectTarget(u, safeMethod));
+    request.setRawHeader("Accept", "application/vnd.vimeo.*+json;version=3.2");
+    
+    switch (operation) {
+    case Request::PostOperation:
+    case Request::PutOperation:
+    case Request::PatchOperation:
+        request.setHeader(QNetworkRequest::ContentTypeHeader, "application/x-www-form-urlencoded");
+        break;
+    default:
+        break;
+    }
+    
+    // Set explicitly, so that the response is decompressed by readReply() and the compressed size is known, 
+    // even when a custom QNetworkAccessManager is used
+    request.setRawHeader("Accept-Encoding", "gzip, deflate");
+#if QT_VERSION >= 0x050800
+    // Multiplex concurrent requests to the same host over one connection where the server supports HTTP/2
+    request.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+#endif
+    Network::setSslSession(&request);
+    
+    if ((authRequired) && (!accessToken.isEmpty())) {
+        request.setRawHeader("Authorization", "Bearer " + accessToken.toUtf8());
+    }
+    
+    if ((operation == Request::GetOperation) && (cacheEnabled) && (canCacheResult())) {
+        cacheKey = cacheKeyForUrl(u);
+        CacheEntry entry;
+        
+        if (CachePrivate::find(cacheKey, &entry)) {
+            if (!entry.etag.isEmpty()) {
+                request.setRawHeader("If-None-Match", entry.etag);
+            }
+            
+            if (!entry.lastModified.isEmpty()) {
+                request.setRawHeader("If-Modified-Since", entry.lastModified);
+            }
+        }
+    }
+    else {
+        cacheKey.clear();
+    }
+    
+    if (!headers.isEmpty()) {
+        addRequestHeaders(&request, headers);
+    }
+    
+    return request;
+}
+
+void RequestPrivate::followRedirect(const QUrl &redirect, int status) {
+    redirects++;
+    
+    switch (status) {
+    case 307:
+    case 308:
+        // The method and body must not be changed
+        sendRequest(buildRequest(redirect), lastVerb, lastBody);
+        break;
+    default:
+        // Other methods are changed to GET, but HEAD requests must not download the body
+        sendRequest(buildRequest(redirect), lastVerb == "HEAD" ? QByteArray("HEAD") : QByteArray("GET"));
+        break;
+    }
+}
+
+bool RequestPrivate::canParseIncrementally() const {
+    return true;
+}
+
+bool RequestPrivate::canCacheResult() const {
+    return true;
+}
+
+QString RequestPrivate::cacheKeyForUrl(const QUrl &u) const {
+    // The result depends on how the response is parsed, as well as on what is requested
+    const bool compact = (compactResult) && (!((incrementalParsing) && (canParseIncrementally())));
+    // Header names are case-insensitive, so they are compared in lower case
+    QStringList h;
+    QMapIterator<QString, QVariant> iterator(headers);
+    
+    while (iterator.hasNext()) {
+        iterator.next();
+        const QVariant &value = iterator.value();
+        h << iterator.key().toLower() + ": "
+             + QString::fromUtf8((value.type() == QVariant::String) || (value.type() == QVariant::ByteArray)
+                                 ? value.toByteArray() : QtJson::Json::serialize(value));
+    }
+    
+    h.sort();
+    return u.toString() + "\n" + (authRequired ? accessToken : QString()) + (authRequired ? "\na\n" : "\n\n")
+           + h.join("\n") + "\n" + projection.paths().join(",") + (compact ? "\nc" : "\n");
+}
+
+void RequestPrivate::sendRequest(const QNetworkRequest &request, const QByteArray &verb, const QByteArray &body) {
+    if (reply) {
+        delete reply;
+        reply = 0;
+    }
+    
+    stopRetry();
+    cancelHedge();
+    lastRequest = request;
+    lastVerb = verb;
+    lastBody = body;
+    reply = createReply(request, verb, body);
+    connectReply();
+    
+    if ((hedgingEnabled) && ((verb == "GET") || (verb == "HEAD"))) {
+        const int latency = Network::latency(request.url().host(), hedgingPercentile);
+        startTimer(&hedgeTimer, latency >= 0 ? latency : DEFAULT_HEDGING_DELAY, SLOT(_q_onHedgeTimeout()));
+    }
+}
+
+void RequestPrivate::cancelHedge() {
+    if (hedgeTimer) {
+        hedgeTimer->stop();
+    }
+    
+    if (hedgeReply) {
         Q_Q(Request);
-        ownNetworkAccessManager = true;
-        manager = new QNetworkAccessManager(q);
+        Request::disconnect(hedgeReply, 0, q, 0);
+        hedgeReply->abort();
+        hedgeReply->deleteLater();
+        hedgeReply = 0;
+    }
+}
+
+QNetworkReply* RequestPrivate::createReply(const QNetworkRequest &request, const QByteArray &verb,
+                                           const QByteArray &body) {
+    if (verb == "GET") {
+        return networkAccessManager()->get(request);
+    }
+    
+    if (verb == "HEAD") {
+        return networkAccessManager()->head(request);
+    }
+    
+    if (verb == "POST") {
+        return networkAccessManager()->post(request, body);
+    }
+    
+    if (verb == "PUT") {
+        return networkAccessManager()->put(request, body);
+    }
+    
+    if (verb == "DELETE") {
+        return networkAccessManager()->deleteResource(request);
+    }
+    
+    // The body of a custom request is read from a device, which must remain valid until the reply is deleted
+    QBuffer *buffer = new QBuffer;
+    buffer->setData(body);
+    buffer->open(QBuffer::ReadOnly);
+    QNetworkReply *customReply = networkAccessManager()->sendCustomRequest(request, verb, buffer);
+    buffer->setParent(customReply);
+    return customReply;
+}
+
+bool RequestPrivate::canRetry(int e, int statusCode) const {
+    // Items that have already been reported cannot be withdrawn
+    if ((retries >= retryPolicy.maximumRetries()) || (itemsEmitted)) {
+        return false;
+    }
+    
+    // A request that was rejected by the rate limit was not processed, so it can always be repeated
+    if (statusCode == 429) {
+        return retryPolicy.isRetryable(e, statusCode);
+    }
+    
+    switch (operation) {
+    case Request::HeadOperation:
+    case Request::GetOperation:
+    case Request::PutOperation:
+    case Request::DeleteOperation:
+        return retryPolicy.isRetryable(e, statusCode);
+    default:
+        return false;
+    }
+}
+
+int RequestPrivate::retryAfter(const QByteArray &value) {
+    if (value.isEmpty()) {
+        return 0;
+    }
+    
+    bool ok = false;
+    const int seconds = value.trimmed().toInt(&ok);
+    
+    if (ok) {
+        return qMax(0, seconds) * 1000;
+    }
+    
+    QDateTime time = QLocale::c().toDateTime(QString::fromLatin1(value.trimmed()).section(' ', 0, 4),
+                                             "ddd, dd MMM yyyy hh:mm:ss");
+    
+    if (!time.isValid()) {
+        return 0;
+    }
+    
+    time.setTimeSpec(Qt::UTC);
+    return int(qMax(qint64(0), time.toMSecsSinceEpoch() - QDateTime::currentMSecsSinceEpoch()));
+}
+
+bool RequestPrivate::isRateLimited() const {
+    return lastRequest.url().host() == QUrl(API_URL).host();
+}
+
+void RequestPrivate::resetResponse() {
+    parser.reset();
+    parser.setProjection(projection);
+    bytesReceived = 0;
+    responseSize = 0;
+    encoding = UnknownEncoding;
+    
+    if (inflater) {
+        inflateEnd(inflater);
+        delete inflater;
+        inflater = 0;
+    }
+}
+
+QByteArray RequestPrivate::readReply() {
+    QByteArray data = reply->readAll();
+    bytesReceived += data.size();
+    
+    if (encoding == UnknownEncoding) {
+        const QByteArray contentEncoding = reply->rawHeader("Content-Encoding").trimmed().toLower();
+        
+        if ((contentEncoding == "gzip") || (contentEncoding == "x-gzip")) {
+            encoding = GzipEncoding;
+        }
+        else if (contentEncoding == "deflate") {
+            encoding = DeflateEncoding;
+        }
+        else {
+            encoding = IdentityEncoding;
+        }
+    }
+    
+    if ((encoding != IdentityEncoding) && (!data.isEmpty())) {
+        data = inflate(data);
+    }
+    
+    responseSize += data.size();
+    return data;
+}
+
+QByteArray RequestPrivate::inflate(const QByteArray &data) {
+    if (!inflater) {
+        inflater = new z_stream;
+        inflater->zalloc = Z_NULL;
+        inflater->zfree = Z_NULL;
+        inflater->opaque = Z_NULL;
+        inflater->next_in = Z_NULL;
+        inflater->avail_in = 0;
+        // Adding 16 to the window bits selects the gzip wrapper, and deflate is normally zlib wrapped
+        inflateInit2(inflater, encoding == GzipEncoding ? MAX_WBITS + 16 : MAX_WBITS);
     }
     
-    return manager;
+    QByteArray output;
+    output.reserve(data.size() * 4);
+    inflater->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.constData()));
+    inflater->avail_in = uInt(data.size());
+    
+    do {
+        const int offset = output.size();
+        output.resize(offset + qMax(INFLATE_CHUNK_SIZE, int(inflater->avail_in) * 4));
+        inflater->next_out = reinterpret_cast<Bytef*>(output.data() + offset);
+        inflater->avail_out = uInt(output.size() - offset);
+        int ret = ::inflate(inflater, Z_NO_FLUSH);
+        
+        if ((ret == Z_DATA_ERROR) && (encoding == DeflateEncoding) && (inflater->total_out == 0)
+            && (inflater->total_in <= uLong(data.size()))) {
+            // Some servers send raw deflate data without the zlib wrapper
+            inflateEnd(inflater);
+            inflateInit2(inflater, -MAX_WBITS);
+            inflater->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.constData()));
+            inflater->avail_in = uInt(data.size());
+            inflater->next_out = reinterpret_cast<Bytef*>(output.data() + offset);
+            inflater->avail_out = uInt(output.size() - offset);
+            ret = ::inflate(inflater, Z_NO_FLUSH);
+        }
+        
+        output.resize(output.size() - int(inflater->avail_out));
+        
+        if (ret == Z_STREAM_END) {
+            break;
+        }
+        
+        if ((ret != Z_OK) && (ret != Z_BUF_ERROR)) {
+            // The truncated output causes a parse error
+            qDebug() << "QVimeo::RequestPrivate::inflate: Unable to decompress response" << ret;
+            break;
+        }
+    } while ((inflater->avail_in > 0) || (inflater->avail_out == 0));
+    
+    return output;
 }
 
-void RequestPrivate::setOperation(Request::Operation op) {
-    if (op != operation) {
-        Q_Q(Request);
-        operation = op;
-        emit q->operationChanged();
-    }
-#ifdef QVIMEO_DEBUG
-    qDebug() << "QVimeo::RequestPrivate::setOperation " << Request::Operation(op);
-#endif
+bool RequestPrivate::isSuccessStatus(int statusCode) {
+    return (statusCode >= 200) && (statusCode < 300);
 }
 
-void RequestPrivate::setStatus(Request::Status s) {
-    if (s != status) {
-        Q_Q(Request);
-        status = s;
-        emit q->statusChanged(s);
+void RequestPrivate::feedParser() {
+    if ((bytesReceived == 0)
+        && (!isSuccessStatus(reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt()))) {
+        // Error responses are kept in full, so that the explanation from the server is not lost
+        parser.setProjection(QtJson::JsonProjection());
     }
-#ifdef QVIMEO_DEBUG
-    qDebug() << "QVimeo::RequestPrivate::setStatus " << Request::Status(s);
-#endif
+    
+    parser.feed(readReply());
 }
 
-void RequestPrivate::setError(Request::Error e) {
-    error = e;
-#ifdef QVIMEO_DEBUG
-    qDebug() << "QVimeo::RequestPrivate::setError " << Request::Error(e);
+void RequestPrivate::connectReply() {
+    Q_Q(Request);
+    
+    Request::connect(reply, SIGNAL(finished()), q, SLOT(_q_onReplyFinished()));
+#if QT_VERSION >= 0x050200
+    Request::connect(reply, SIGNAL(encrypted()), q, SLOT(_q_onReplyEncrypted()));
 #endif
+    Network::addReply(reply);
+    
+    if (readTimeout > 0) {
+        Request::connect(reply, SIGNAL(downloadProgress(qint64,qint64)), q, SLOT(_q_onReplyActivity()));
+        Request::connect(reply, SIGNAL(uploadProgress(qint64,qint64)), q, SLOT(_q_onReplyActivity()));
+        startTimer(&readTimer, readTimeout, SLOT(_q_onTimeout()));
+    }
+    
+    resetResponse();
+    itemsEmitted = false;
+    replyTime.start();
+    incrementalReply = (incrementalParsing) && (canParseIncrementally());
+    compactReply = (compactResult) && (!incrementalReply);
+    
+    if (incrementalReply) {
+        Request::connect(reply, SIGNAL(readyRead()), q, SLOT(_q_onReplyReadyRead()));
+    }
 }
 
-void RequestPrivate::setErrorString(const QString &es) {
-    errorString = es;
-#ifdef QVIMEO_DEBUG
-    qDebug() << "QVimeo::RequestPrivate::setErrorString " << es;
-#endif
+void RequestPrivate::_q_onReplyEncrypted() {
+    Q_Q(Request);
+    
+    if (QNetworkReply *r = qobject_cast<QNetworkReply*>(q->sender())) {
+        Network::addSslSession(r);
+    }
 }
 
-void RequestPrivate::setResult(const QVariant &res) {
-    result = res;
+void RequestPrivate::startGet() {
+    Q_Q(Request);
+    
+    if (canCacheResult()) {
+        // Requests can only share a response that they would parse in the same way
+        const bool incremental = (incrementalParsing) && (canParseIncrementally());
+        const QString key = cacheKeyForUrl(url) + "\n" + QString::number(quintptr(networkAccessManager()))
+                            + (incremental ? "\ni" + parser.elementsKey() : QString("\n"));
+        Request *request = inFlightRequests()->value(key);
+        
+        if ((request) && (request != q)) {
+            // Items that the request has already emitted cannot be received by this one
+            if ((!incremental) || (!request->d_func()->itemsEmitted)) {
 #ifdef QVIMEO_DEBUG
-    qDebug() << "QVimeo::RequestPrivate::setResult " << res;
+                qDebug() << "QVimeo::RequestPrivate::startGet: Joining request in progress" << url;
 #endif
+                leader = request;
+                itemsEmitted = false;
+                Request::connect(request, SIGNAL(finished()), q, SLOT(_q_onLeaderFinished()));
+                Request::connect(request, SIGNAL(destroyed()), q, SLOT(_q_onLeaderDestroyed()));
+                
+                if (incremental) {
+                    Request::connect(request, SIGNAL(itemsReady(QVariantList)),
+                                     q, SLOT(_q_onLeaderItemsReady(QVariantList)));
+                }
+                
+                return;
+            }
+        }
+        else {
+            inFlightKey = key;
+            inFlightRequests()->insert(key, q);
+        }
+    }
+    
+    sendRequest(buildRequest(authRequired), "GET");
 }
 
-QNetworkRequest RequestPrivate::buildRequest(bool authRequired) {
-    return buildRequest(url, authRequired);
+void RequestPrivate::detachFromLeader() {
+    if (leader) {
+        Q_Q(Request);
+        Request::disconnect(leader, 0, q, 0);
+    }
+    
+    leader = 0;
+    // The request may be restarted while still loading, in which case its status does not change
+    leaveInFlight();
 }
 
-QNetworkRequest RequestPrivate::buildRequest(QUrl u, bool authRequired) {
-#ifdef QVIMEO_DEBUG
-    qDebug() << "QVimeo::RequestPrivate::buildRequest " << u;
-#endif
-    QNetworkRequest request(u);
-    request.setRawHeader("Accept", "application/vnd.vimeo.*+json;version=3.2");
-    
-    switch (operation) {
-    case Request::PostOperation:
-    case Request::PutOperation:
-    case Request::PatchOperation:
-        request.setHeader(QNetworkRequest::ContentTypeHeader, "application/x-www-form-urlencoded");
-        break;
-    default:
-        break;
+void RequestPrivate::leaveInFlight() {
+    if (inFlightKey.isEmpty()) {
+        return;
     }
     
-    if ((authRequired) && (!accessToken.isEmpty())) {
-        request.setRawHeader("Authorization", "Bearer " + accessToken.toUtf8());
+    Q_Q(Request);
+    
+    if (inFlightRequests()->value(inFlightKey) == q) {
+        inFlightRequests()->remove(inFlightKey);
     }
     
-    if (!headers.isEmpty()) {
-        addRequestHeaders(&request, headers);
+    inFlightKey.clear();
+}
+
+void RequestPrivate::emitItemsReady() {
+    if (parser.elementsKey().isEmpty()) {
+        return;
     }
     
-    return request;
+    const QVariantList items = parser.takeElements();
+    
+    if (!items.isEmpty()) {
+        Q_Q(Request);
+        itemsEmitted = true;
+        emit q->itemsReady(items);
+    }
 }
 
-void RequestPrivate::followRedirect(const QUrl &redirect) {
-    Q_Q(Request);
+void RequestPrivate::_q_onReplyActivity() {
+    if ((reply) && (readTimer) && (readTimer->isActive())) {
+        readTimer->start();
+    }
+}
+
+void RequestPrivate::_q_onTimeout() {
+    if (status != Request::Loading) {
+        return;
+    }
     
-    redirects++;
+    Q_Q(Request);
     
+    timedOut = true;
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::RequestPrivate::_q_onTimeout" << url;
+#endif
     if (reply) {
-        delete reply;
+        // The reply is reported as canceled, and setCanceled() reports the timeout
+        reply->abort();
+        return;
     }
-        
-    reply = networkAccessManager()->get(buildRequest(redirect));
-    Request::connect(reply, SIGNAL(finished()), q, SLOT(_q_onReplyFinished()));
+    
+    cacheHitPending = false;
+    stopRetry();
+    detachFromLeader();
+    setCanceled();
+    emit q->finished();
 }
 
-void RequestPrivate::_q_onReplyFinished() {
+void RequestPrivate::_q_onReplyReadyRead() {
     if (!reply) {
         return;
     }
     
-    Q_Q(Request);
+    feedParser();
+    emitItemsReady();
+}
+
+bool RequestPrivate::redirectOrRetry() {
+    RateLimitPrivate::update(accessToken, reply);
+    cancelHedge();
+    
+    if (readTimer) {
+        readTimer->stop();
+    }
+    
+    if (reply->error() == QNetworkReply::NoError) {
+        Network::addLatency(reply->url().host(), int(replyTime.elapsed()));
+        Network::addProtocol(reply);
+    }
     
     if (redirects < MAX_REDIRECTS) {
         QUrl redirect = reply->attribute(QNetworkRequest::RedirectionTargetAttribute).toString();
@@ -868,19 +1878,115 @@ void RequestPrivate::_q_onReplyFinished() {
         }
     
         if (!redirect.isEmpty()) {
+            const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+            redirect = reply->url().resolved(redirect);
+            
+            if (((status == 301) || (status == 308)) && (redirect != reply->url())) {
+                Network::addRedirect(reply->url(), redirect, status == 308);
+            }
+            
             reply->deleteLater();
             reply = 0;
-            followRedirect(redirect);
-            return;
+            followRedirect(redirect, status);
+            return true;
+        }
+    }
+    
+    const int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    
+    if (canRetry(reply->error(), statusCode)) {
+        retries++;
+        int delay = qMax(retryPolicy.delay(retries), retryAfter(reply->rawHeader("Retry-After")));
+        
+        if (isRateLimited()) {
+            delay = qMax(delay, RateLimit::delay(accessToken));
+        }
+#ifdef QVIMEO_DEBUG
+        qDebug() << "QVimeo::RequestPrivate::redirectOrRetry: Retrying" << reply->url() << reply->error()
+                 << statusCode << retries << delay;
+#endif
+        reply->deleteLater();
+        reply = 0;
+        retryPending = true;
+        startTimer(&retryTimer, delay, SLOT(_q_retry()));
+        return true;
+    }
+    
+    return false;
+}
+
+void RequestPrivate::_q_onReplyFinished() {
+    if (!reply) {
+        return;
+    }
+    
+    Q_Q(Request);
+    
+    if (redirectOrRetry()) {
+        return;
+    }
+    
+    const int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    
+    if ((statusCode == 304) && (!cacheKey.isEmpty())) {
+        CacheEntry entry;
+        const QUrl u = reply->url();
+        reply->deleteLater();
+        reply = 0;
+        
+        if (CachePrivate::find(cacheKey, &entry)) {
+            CachePrivate::addRevalidation();
+            CachePrivate::insert(cacheKey, entry);
+            setCachedResult(entry);
+            setStatus(Request::Ready);
+            setError(Request::NoError);
+            setErrorString(QString());
+            emit q->finished();
+        }
+        else {
+            // The result was removed from the cache after the request was made, so request it in full
+            sendRequest(buildRequest(u), "GET");
         }
+        
+        return;
     }
     
     bool ok = true;
-    const QString response = QString::fromUtf8(reply->readAll());
-    setResult(response.isEmpty() ? response : QtJson::Json::parse(response, ok));
+    
+    if (incrementalReply) {
+        feedParser();
+        ok = (parser.isEmpty()) || (parser.finish());
+        
+        if (reply->error() == QNetworkReply::NoError) {
+            emitItemsReady();
+        }
+        
+        setResult(parser.isEmpty() ? QVariant(QString()) : parser.result());
+        parser.reset();
+    }
+    else if (compactReply) {
+        const QByteArray response = readReply();
+        
+        if (response.isEmpty()) {
+            setResult(QVariant(QString()));
+        }
+        else {
+            setResultDocument(QtJson::Json::parseDocument(response, ok));
+        }
+    }
+    else {
+        const QByteArray response = readReply();
+        // Error responses are kept in full, so that the explanation from the server is not lost
+        setResult(response.isEmpty() ? QVariant(QString())
+                                     : QtJson::Json::parse(response, isSuccessStatus(statusCode)
+                                                           ? parser.projection() : QtJson::JsonProjection(), ok));
+    }
     
     const QNetworkReply::NetworkError e = reply->error();
     const QString es = reply->errorString();
+    const QByteArray etag = reply->rawHeader("ETag");
+    const QByteArray lastModified = reply->rawHeader("Last-Modified");
+    const QString path = reply->url().path();
     reply->deleteLater();
     reply = 0;
     
@@ -888,9 +1994,7 @@ void RequestPrivate::_q_onReplyFinished() {
     case QNetworkReply::NoError:
         break;
     case QNetworkReply::OperationCanceledError:
-        setStatus(Request::Canceled);
-        setError(Request::NoError);
-        setErrorString(QString());
+        setCanceled();
         emit q->finished();
         return;
     default:
@@ -902,6 +2006,32 @@ void RequestPrivate::_q_onReplyFinished() {
     }
     
     if (ok) {
+        if ((statusCode == 200) && (!cacheKey.isEmpty())) {
+            CachePrivate::addMiss();
+        }
+        
+        if ((statusCode == 200) && (!cacheKey.isEmpty())
+            && ((!etag.isEmpty()) || (!lastModified.isEmpty()) || (Cache::timeToLive(path) > 0))) {
+            CacheEntry entry;
+            entry.path = path;
+            entry.cost = int(responseSize);
+            entry.etag = etag;
+            entry.lastModified = lastModified;
+            
+            if (document.isNull()) {
+                entry.result = result;
+            }
+            else {
+                entry.document = document;
+            }
+            
+            CachePrivate::insert(cacheKey, entry);
+        }
+        else if ((operation != Request::GetOperation) && (operation != Request::HeadOperation)) {
+            // Cached results for the modified resources are now stale
+            CachePrivate::removePath(path);
+        }
+        
         setStatus(Request::Ready);
         setError(Request::NoError);
         setErrorString(QString());
@@ -915,6 +2045,179 @@ void RequestPrivate::_q_onReplyFinished() {
     emit q->finished();
 }
 
+void RequestPrivate::_q_loadCachedResult() {
+    if (!cacheHitPending) {
+        return;
+    }
+    
+    Q_Q(Request);
+    
+    cacheHitPending = false;
+    incrementalReply = (incrementalParsing) && (canParseIncrementally());
+    CacheEntry entry;
+    
+    if (CachePrivate::find(cacheKey, &entry)) {
+        CachePrivate::addHit();
+        setCachedResult(entry);
+        setStatus(Request::Ready);
+        setError(Request::NoError);
+        setErrorString(QString());
+        emit q->finished();
+    }
+    else {
+        // The result was removed from the cache after the request was made, so request it from the network
+        startGet();
+    }
+}
+
+void RequestPrivate::_q_retry() {
+    if (!retryPending) {
+        return;
+    }
+    
+    if (isRateLimited()) {
+        // Other requests may have used the rate limit while this one was waiting
+        const int delay = RateLimit::delay(accessToken);
+        
+        if (delay > 0) {
+            startTimer(&retryTimer, delay, SLOT(_q_retry()));
+            return;
+        }
+        
+        RateLimitPrivate::addRequest(accessToken);
+    }
+    
+    retryPending = false;
+    reply = createReply(lastRequest, lastVerb, lastBody);
+    connectReply();
+}
+
+void RequestPrivate::_q_onHedgeTimeout() {
+    // Once items have been reported, the response cannot be replaced
+    if ((!reply) || (hedgeReply) || (itemsEmitted) || (status != Request::Loading)) {
+        return;
+    }
+    
+    if (isRateLimited()) {
+        // The extra request is not worth spending the last of the rate limit on
+        const int limit = RateLimit::limit(accessToken);
+        
+        if ((RateLimit::delay(accessToken) > 0)
+            || ((limit > 0) && (RateLimit::remaining(accessToken) * 100 < limit * MIN_HEDGING_RATE_LIMIT_PERCENT))) {
+#ifdef QVIMEO_DEBUG
+            qDebug() << "QVimeo::RequestPrivate::_q_onHedgeTimeout: Not hedging due to the rate limit"
+                     << lastRequest.url();
+#endif
+            return;
+        }
+        
+        RateLimitPrivate::addRequest(accessToken);
+    }
+    
+    Q_Q(Request);
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::RequestPrivate::_q_onHedgeTimeout" << lastRequest.url();
+#endif
+    Network::addHedge(false);
+    hedgeReply = createReply(lastRequest, lastVerb, lastBody);
+    Network::addReply(hedgeReply);
+    Request::connect(hedgeReply, SIGNAL(finished()), q, SLOT(_q_onHedgeFinished()));
+#if QT_VERSION >= 0x050200
+    Request::connect(hedgeReply, SIGNAL(encrypted()), q, SLOT(_q_onReplyEncrypted()));
+#endif
+}
+
+void RequestPrivate::_q_onHedgeFinished() {
+    if (!hedgeReply) {
+        return;
+    }
+    
+    if ((!reply) || (itemsEmitted) || (hedgeReply->error() != QNetworkReply::NoError)) {
+        // Keep waiting for the original reply
+        hedgeReply->deleteLater();
+        hedgeReply = 0;
+        return;
+    }
+    
+    Q_Q(Request);
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::RequestPrivate::_q_onHedgeFinished: Hedged request finished first" << lastRequest.url();
+#endif
+    Network::addHedge(true);
+    QNetworkReply *slowReply = reply;
+    reply = hedgeReply;
+    hedgeReply = 0;
+    Request::disconnect(slowReply, 0, q, 0);
+    slowReply->abort();
+    slowReply->deleteLater();
+    resetResponse();
+    _q_onReplyFinished();
+}
+
+void RequestPrivate::_q_onLeaderFinished() {
+    if (!leader) {
+        return;
+    }
+    
+    Q_Q(Request);
+    
+    const RequestPrivate *d = leader->d_func();
+    detachFromLeader();
+    
+    switch (d->status) {
+    case Request::Ready:
+        if (d->document.isNull()) {
+            setResult(d->result);
+        }
+        else {
+            setResultDocument(d->document);
+        }
+        
+        setStatus(Request::Ready);
+        setError(Request::NoError);
+        setErrorString(QString());
+        emit q->finished();
+        break;
+    case Request::Failed:
+        setResult(d->result);
+        setStatus(Request::Failed);
+        setError(d->error);
+        setErrorString(d->errorString);
+        emit q->finished();
+        break;
+    default:
+        // The request that was joined was canceled, but this one was not
+        restartAfterLeader();
+        break;
+    }
+}
+
+void RequestPrivate::_q_onLeaderDestroyed() {
+    leader = 0;
+    restartAfterLeader();
+}
+
+void RequestPrivate::_q_onLeaderItemsReady(const QVariantList &items) {
+    Q_Q(Request);
+    
+    itemsEmitted = true;
+    emit q->itemsReady(items);
+}
+
+void RequestPrivate::restartAfterLeader() {
+    if (!itemsEmitted) {
+        startGet();
+        return;
+    }
+    
+    // A new request would emit the items that have already been received again
+    Q_Q(Request);
+    setStatus(Request::Failed);
+    setError(Request::OperationCanceledError);
+    setErrorString(Request::tr("The request that was joined was canceled"));
+    emit q->finished();
+}
+
 }
 
 #include "moc_request.cpp"
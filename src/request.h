@@ -18,8 +18,11 @@
 #define QVIMEO_REQUEST_H
 
 #include "qvimeo_global.h"
+#include "json.h"
+#include "retrypolicy.h"
 #include <QObject>
 #include <QVariantMap>
+#include <QStringList>
 
 class QUrl;
 class QString;
@@ -27,6 +30,7 @@ class QNetworkAccessManager;
 
 namespace QVimeo {
 
+class DispatcherPrivate;
 class RequestPrivate;
 
 class QVIMEOSHARED_EXPORT Request : public QObject
@@ -44,6 +48,19 @@ class QVIMEOSHARED_EXPORT Request : public QObject
     Q_PROPERTY(QVariant result READ result NOTIFY finished)
     Q_PROPERTY(Error error READ error NOTIFY finished)
     Q_PROPERTY(QString errorString READ errorString NOTIFY finished)
+    Q_PROPERTY(bool incrementalParsing READ incrementalParsing WRITE setIncrementalParsing
+               NOTIFY incrementalParsingChanged)
+    Q_PROPERTY(QString itemsKey READ itemsKey WRITE setItemsKey NOTIFY itemsKeyChanged)
+    Q_PROPERTY(QStringList projection READ projection WRITE setProjection NOTIFY projectionChanged)
+    Q_PROPERTY(bool compactResult READ compactResult WRITE setCompactResult NOTIFY compactResultChanged)
+    Q_PROPERTY(bool cacheEnabled READ cacheEnabled WRITE setCacheEnabled NOTIFY cacheEnabledChanged)
+    Q_PROPERTY(int timeout READ timeout WRITE setTimeout NOTIFY timeoutChanged)
+    Q_PROPERTY(int readTimeout READ readTimeout WRITE setReadTimeout NOTIFY readTimeoutChanged)
+    Q_PROPERTY(qint64 bytesReceived READ bytesReceived NOTIFY finished)
+    Q_PROPERTY(qint64 responseSize READ responseSize NOTIFY finished)
+    Q_PROPERTY(bool hedgingEnabled READ hedgingEnabled WRITE setHedgingEnabled NOTIFY hedgingEnabledChanged)
+    Q_PROPERTY(int hedgingPercentile READ hedgingPercentile WRITE setHedgingPercentile
+               NOTIFY hedgingPercentileChanged)
     
     Q_ENUMS(Operation Status Error)
     
@@ -102,7 +119,10 @@ public:
         ProtocolFailure = 399,
         
         // Json parser error
-        ParseError = 401
+        ParseError = 401,
+        
+        // Request errors
+        RequestTimeoutError = 501
     };
     
     explicit Request(QObject *parent = 0);
@@ -128,10 +148,45 @@ public:
     Status status() const;
     
     QVariant result() const;
+    QtJson::JsonDocument resultDocument() const;
+    Q_INVOKABLE QVariant resultValue(const QString &pointer) const;
     
     Error error() const;
     QString errorString() const;
     
+    bool incrementalParsing() const;
+    void setIncrementalParsing(bool enabled);
+    
+    QString itemsKey() const;
+    void setItemsKey(const QString &key);
+    
+    QStringList projection() const;
+    void setProjection(const QStringList &paths);
+    
+    bool compactResult() const;
+    void setCompactResult(bool enabled);
+    
+    bool cacheEnabled() const;
+    void setCacheEnabled(bool enabled);
+    
+    int timeout() const;
+    void setTimeout(int msecs);
+    
+    int readTimeout() const;
+    void setReadTimeout(int msecs);
+    
+    qint64 bytesReceived() const;
+    qint64 responseSize() const;
+    
+    bool hedgingEnabled() const;
+    void setHedgingEnabled(bool enabled);
+    
+    int hedgingPercentile() const;
+    void setHedgingPercentile(int percentile);
+    
+    RetryPolicy retryPolicy() const;
+    void setRetryPolicy(const RetryPolicy &policy);
+    
     void setNetworkAccessManager(QNetworkAccessManager *manager);
     
 public Q_SLOTS:
@@ -159,6 +214,16 @@ Q_SIGNALS:
     void headersChanged();
     void operationChanged();
     void statusChanged(Status s);
+    void incrementalParsingChanged();
+    void itemsKeyChanged();
+    void projectionChanged();
+    void compactResultChanged();
+    void cacheEnabledChanged();
+    void timeoutChanged();
+    void readTimeoutChanged();
+    void hedgingEnabledChanged();
+    void hedgingPercentileChanged();
+    void itemsReady(const QVariantList &items);
     void finished();
     
 protected:
@@ -168,7 +233,20 @@ protected:
     
     Q_DECLARE_PRIVATE(Request)
     
+    friend class DispatcherPrivate;
+    
+    Q_PRIVATE_SLOT(d_func(), void _q_onReplyReadyRead())
     Q_PRIVATE_SLOT(d_func(), void _q_onReplyFinished())
+    Q_PRIVATE_SLOT(d_func(), void _q_onReplyEncrypted())
+    Q_PRIVATE_SLOT(d_func(), void _q_loadCachedResult())
+    Q_PRIVATE_SLOT(d_func(), void _q_retry())
+    Q_PRIVATE_SLOT(d_func(), void _q_onReplyActivity())
+    Q_PRIVATE_SLOT(d_func(), void _q_onTimeout())
+    Q_PRIVATE_SLOT(d_func(), void _q_onHedgeTimeout())
+    Q_PRIVATE_SLOT(d_func(), void _q_onHedgeFinished())
+    Q_PRIVATE_SLOT(d_func(), void _q_onLeaderFinished())
+    Q_PRIVATE_SLOT(d_func(), void _q_onLeaderDestroyed())
+    Q_PRIVATE_SLOT(d_func(), void _q_onLeaderItemsReady(QVariantList))
     
 private:
     Q_DISABLE_COPY(Request)
@@ -19,9 +19,13 @@
 
 #include "request.h"
 #include "json.h"
+#include "cache_p.h"
+#include "retrypolicy.h"
 #include <QUrl>
 #include <QVariantMap>
 #include <QNetworkRequest>
+#include <QPointer>
+#include <QElapsedTimer>
 #if QT_VERSION >= 0x050000
 #include <QUrlQuery>
 #endif
@@ -30,12 +34,21 @@
 #endif
 
 class QNetworkReply;
-class QBuffer;
+class QTimer;
+
+struct z_stream_s;
 
 namespace QVimeo {
 
 static const int MAX_REDIRECTS = 8;
 
+static const int DEFAULT_HEDGING_PERCENTILE = 95;
+static const int DEFAULT_HEDGING_DELAY = 1000;
+// Hedging stops once fewer than this percentage of the rate limit remain
+static const int MIN_HEDGING_RATE_LIMIT_PERCENT = 10;
+
+static const int INFLATE_CHUNK_SIZE = 16384;
+
 #if QT_VERSION >= 0x050000
 inline void addUrlQueryItems(QUrlQuery *query, const QVariantMap &map) {
 #ifdef QVIMEO_DEBUG
@@ -130,6 +143,13 @@ class RequestPrivate
 {
 
 public:
+    enum Encoding {
+        UnknownEncoding = 0,
+        IdentityEncoding,
+        GzipEncoding,
+        DeflateEncoding
+    };
+    
     RequestPrivate(Request *parent);
     virtual ~RequestPrivate();
     
@@ -139,32 +159,85 @@ public:
     
     void setStatus(Request::Status s);
     
+    void setCanceled();
+    
+    void startTimer(QTimer **timer, int msecs, const char *slot);
+    void stopTimers();
+    void stopRetry();
+    
     void setError(Request::Error e);
     
     void setErrorString(const QString &es);
     
     void setResult(const QVariant &res);
+    void setResultDocument(const QtJson::JsonDocument &doc);
+    void setCachedResult(const CacheEntry &entry);
     
     virtual QNetworkRequest buildRequest(bool authRequired = true);
     virtual QNetworkRequest buildRequest(QUrl u, bool authRequired = true);
     
-    virtual void followRedirect(const QUrl &redirect);
+    virtual void followRedirect(const QUrl &redirect, int status);
+    
+    virtual bool canParseIncrementally() const;
+    
+    virtual bool canCacheResult() const;
+    
+    QString cacheKeyForUrl(const QUrl &u) const;
+    
+    void sendRequest(const QNetworkRequest &request, const QByteArray &verb, const QByteArray &body = QByteArray());
+    QNetworkReply* createReply(const QNetworkRequest &request, const QByteArray &verb, const QByteArray &body);
+    
+    void cancelHedge();
+    
+    void resetResponse();
+    QByteArray readReply();
+    void feedParser();
+    static bool isSuccessStatus(int statusCode);
+    QByteArray inflate(const QByteArray &data);
+    
+    void connectReply();
+    
+    bool canRetry(int e, int statusCode) const;
+    // Records the reply, then follows a redirect or schedules a retry if needed, returning true if it did
+    bool redirectOrRetry();
+    static int retryAfter(const QByteArray &value);
+    
+    bool isRateLimited() const;
+    
+    void startGet();
+    void detachFromLeader();
+    void leaveInFlight();
+    void restartAfterLeader();
         
     void refreshAccessToken();
     void _q_onAccessTokenRefreshed();
     
+    void emitItemsReady();
+    
+    void _q_onReplyReadyRead();
     virtual void _q_onReplyFinished();
     
+    void _q_loadCachedResult();
+    
+    void _q_retry();
+    
+    void _q_onReplyActivity();
+    void _q_onReplyEncrypted();
+    void _q_onTimeout();
+    
+    void _q_onHedgeTimeout();
+    void _q_onHedgeFinished();
+    
+    void _q_onLeaderFinished();
+    void _q_onLeaderDestroyed();
+    void _q_onLeaderItemsReady(const QVariantList &items);
+    
     Request *q_ptr;
     
     QNetworkAccessManager *manager;
     
     QNetworkReply *reply;
     
-    QBuffer *buffer;
-    
-    bool ownNetworkAccessManager;
-    
     QString apiKey;
     QString clientId;
     QString clientSecret;
@@ -177,7 +250,10 @@ public:
     
     QVariant data;
     
-    QVariant result;
+    mutable QVariant result;
+    mutable bool resultPending;
+    
+    QtJson::JsonDocument document;
     
     Request::Operation operation;
     
@@ -189,6 +265,66 @@ public:
     
     int redirects;
     
+    bool incrementalParsing;
+    bool incrementalReply;
+    
+    bool compactResult;
+    bool compactReply;
+    
+    QtJson::JsonProjection projection;
+    
+    bool cacheEnabled;
+    
+    QString cacheKey;
+    
+    bool cacheHitPending;
+    
+    qint64 responseSize;
+    
+    bool authRequired;
+    
+    QString inFlightKey;
+    
+    QPointer<Request> leader;
+    
+    QNetworkRequest lastRequest;
+    QByteArray lastVerb;
+    QByteArray lastBody;
+    
+    RetryPolicy retryPolicy;
+    
+    int retries;
+    
+    bool retryPending;
+    
+    bool itemsEmitted;
+    
+    int timeout;
+    int readTimeout;
+    
+    QTimer *timeoutTimer;
+    QTimer *readTimer;
+    QTimer *retryTimer;
+    
+    bool timedOut;
+    
+    QElapsedTimer replyTime;
+    
+    bool hedgingEnabled;
+    int hedgingPercentile;
+    
+    QTimer *hedgeTimer;
+    
+    QNetworkReply *hedgeReply;
+    
+    qint64 bytesReceived;
+    
+    Encoding encoding;
+    
+    z_stream_s *inflater;
+    
+    QtJson::JsonStreamParser parser;
+    
     Q_DECLARE_PUBLIC(Request)
 };
 
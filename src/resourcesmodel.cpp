@@ -15,6 +15,7 @@
  */
 
 #include "resourcesmodel.h"
+#include "cache.h"
 #include "model_p.h"
 #ifdef QVIMEO_DEBUG
 #include <QDebug>
@@ -29,9 +30,107 @@ public:
     ResourcesModelPrivate(ResourcesModel *parent) :
         ModelPrivate(parent),
         request(0),
-        hasMore(false)
+        hasMore(false),
+        progressive(false),
+        progressiveList(false)
     {
     }
+    
+    QStringList requestProjection(bool list) const {
+        if (projection.isEmpty()) {
+            return QStringList();
+        }
+        
+        // The uri is always needed to update and delete resources
+        const QString prefix = list ? QString("data.") : QString();
+        QStringList paths;
+        
+        if (list) {
+            paths << "total" << "page" << "per_page" << "paging";
+        }
+        
+        paths << prefix + "uri";
+        
+        foreach (const QString &path, projection) {
+            paths << prefix + path;
+        }
+        
+        return paths;
+    }
+    
+    QVariantMap requestFilters() const {
+        if ((projection.isEmpty()) || (filters.contains("fields"))) {
+            return filters;
+        }
+        
+        // Ask the server to leave out the rest of each resource, so that less is sent and parsed
+        QStringList fields;
+        fields << "uri";
+        
+        foreach (const QString &path, projection) {
+            // The fields filter only accepts keys separated by periods, so array subscripts are removed
+            QStringList keys;
+            
+            foreach (QString key, path.split('.', QString::SkipEmptyParts)) {
+                const int bracket = key.indexOf('[');
+                
+                if (bracket >= 0) {
+                    key.truncate(bracket);
+                }
+                
+                if (!key.isEmpty()) {
+                    keys << key;
+                }
+            }
+            
+            if (!keys.isEmpty()) {
+                fields << keys.join(".");
+            }
+        }
+        
+        QVariantMap f = filters;
+        f["fields"] = fields.join(",");
+        return f;
+    }
+    
+    void connectListRequest() {
+        Q_Q(ResourcesModel);
+        
+        progressiveList = progressive;
+        request->setProjection(requestProjection(true));
+        
+        if (progressiveList) {
+            ResourcesModel::connect(request, SIGNAL(itemsReady(QVariantList)),
+                                    q, SLOT(_q_onListRequestItemsReady(QVariantList)));
+        }
+        
+        ResourcesModel::connect(request, SIGNAL(finished()), q, SLOT(_q_onListRequestFinished()));
+    }
+    
+    void appendItems(const QVariantList &list) {
+        if (list.isEmpty()) {
+            return;
+        }
+        
+        Q_Q(ResourcesModel);
+        
+        if (items.isEmpty()) {
+            setRoleNames(list.first().toMap());
+        }
+        
+        q->beginInsertRows(QModelIndex(), items.size(), items.size() + list.size() - 1);
+        
+        foreach (const QVariant &item, list) {
+            items << item.toMap();
+        }
+        
+        q->endInsertRows();
+        emit q->countChanged(q->rowCount());
+    }
+    
+    void _q_onListRequestItemsReady(const QVariantList &list) {
+        appendItems(list);
+    }
         
     void _q_onListRequestFinished() {
         if (!request) {
@@ -45,26 +144,16 @@ public:
         
             if (!result.isEmpty()) {
                 hasMore = !result.value("paging").toMap().value("next").isNull();
-            
-                const QVariantList list = result.value("data").toList();
-            
-                if (!list.isEmpty()) {
-                    if (items.isEmpty()) {
-                        setRoleNames(list.first().toMap());
-                    }
-                    
-                    q->beginInsertRows(QModelIndex(), items.size(), items.size() + list.size() - 1);
-                    
-                    foreach (const QVariant &item, list) {
-                        items << item.toMap();
-                    }
-                    
-                    q->endInsertRows();
-                    emit q->countChanged(q->rowCount());
+                
+                // In progressive mode, the items have already been inserted as they were parsed
+                if (!progressiveList) {
+                    appendItems(result.value("data").toList());
                 }
             }
         }
         
+        ResourcesModel::disconnect(request, SIGNAL(itemsReady(QVariantList)),
+                                   q, SLOT(_q_onListRequestItemsReady(QVariantList)));
         ResourcesModel::disconnect(request, SIGNAL(finished()), q, SLOT(_q_onListRequestFinished()));
     
         emit q->statusChanged(request->status());
@@ -96,6 +185,11 @@ public:
             }
         }
         
+        if ((request->status() == ResourcesRequest::Ready) && (!resourcePath.isEmpty())) {
+            // A cached list of the resources no longer matches the model
+            Cache::remove(resourcePath);
+        }
+        
         ResourcesModel::disconnect(request, SIGNAL(finished()), q, SLOT(_q_onInsertRequestFinished()));
     
         emit q->statusChanged(request->status());
@@ -125,6 +219,11 @@ public:
             }
         }
         
+        if ((request->status() == ResourcesRequest::Ready) && (!resourcePath.isEmpty())) {
+            // A cached list of the resources no longer matches the model
+            Cache::remove(resourcePath);
+        }
+        
         ResourcesModel::disconnect(request, SIGNAL(finished()), q, SLOT(_q_onUpdateRequestFinished()));
     
         emit q->statusChanged(request->status());
@@ -149,6 +248,11 @@ public:
             }
         }
         
+        if ((request->status() == ResourcesRequest::Ready) && (!resourcePath.isEmpty())) {
+            // A cached list of the resources no longer matches the model
+            Cache::remove(resourcePath);
+        }
+        
         ResourcesModel::disconnect(request, SIGNAL(finished()), q, SLOT(_q_onDeleteRequestFinished()));
     
         emit q->statusChanged(request->status());
@@ -163,6 +267,11 @@ public:
         
     bool hasMore;
     
+    bool progressive;
+    bool progressiveList;
+    
+    QStringList projection;
+    
     Q_DECLARE_PUBLIC(ResourcesModel)
 };
 
@@ -371,12 +480,187 @@ QString ResourcesModel::errorString() const {
     return d->request->errorString();
 }
 
+/*!
+    \property bool ResourcesModel::progressive
+    \brief Whether resources are inserted into the model while the response is still being received.
+    
+    When enabled, each resource in a list response is inserted as soon as it has been parsed, rather than 
+    once the whole response has been received, so that the first rows are available almost immediately.
+    
+    If the request subsequently fails, any rows that were inserted are retained.
+    
+    The default is false.
+    
+    \sa ResourcesRequest::incrementalParsing, ResourcesRequest::itemsKey
+*/
+
+/*!
+    \fn void ResourcesModel::progressiveChanged()
+    \brief Emitted when progressive changes.
+*/
+bool ResourcesModel::progressive() const {
+    Q_D(const ResourcesModel);
+    
+    return d->progressive;
+}
+
+void ResourcesModel::setProgressive(bool enabled) {
+    Q_D(ResourcesModel);
+    
+    if (enabled != d->progressive) {
+        d->progressive = enabled;
+        d->request->setIncrementalParsing(enabled);
+        d->request->setItemsKey(enabled ? QString("data") : QString());
+        emit progressiveChanged();
+    }
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::ResourcesModel::setProgressive" << enabled;
+#endif
+}
+
+/*!
+    \property QStringList ResourcesModel::projection
+    \brief The key paths of each resource that are kept in the model.
+    
+    When projection is set, each resource contains only its uri and the values at the given key paths. The rest 
+    of the response is skipped while it is parsed, which reduces both the parsing time and the memory used by 
+    the model. Each path is a list of keys separated by periods, and arrays are transparent, so 
+    "pictures.sizes.link" keeps the link of each picture size.
+    
+    The paths are also sent as the fields filter of list(), fetchMore() and reload() requests, unless the 
+    filters passed to list() already contain one, so that the server leaves out the rest of each resource and 
+    the response is smaller. Array subscripts are removed from the fields filter, so "pictures.sizes[*].link" 
+    is sent as "pictures.sizes.link".
+    
+    Changes take effect from the next request. The default is an empty list, meaning resources are kept in full.
+    
+    \sa ResourcesRequest::projection
+*/
+
+/*!
+    \fn void ResourcesModel::projectionChanged()
+    \brief Emitted when the projection changes.
+*/
+QStringList ResourcesModel::projection() const {
+    Q_D(const ResourcesModel);
+    
+    return d->projection;
+}
+
+void ResourcesModel::setProjection(const QStringList &paths) {
+    Q_D(ResourcesModel);
+    
+    if (paths != d->projection) {
+        d->projection = paths;
+        emit projectionChanged();
+    }
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::ResourcesModel::setProjection" << paths;
+#endif
+}
+
+/*!
+    \property bool ResourcesModel::cacheEnabled
+    \brief Whether the results of list requests are cached and revalidated.
+    
+    When enabled, pages that have already been retrieved are taken from the Cache, so navigating back to a 
+    view does not download and parse them again.
+    
+    The default is false.
+    
+    \sa ResourcesRequest::cacheEnabled, Cache
+*/
+
+/*!
+    \fn void ResourcesModel::cacheEnabledChanged()
+    \brief Emitted when cacheEnabled changes.
+*/
+bool ResourcesModel::cacheEnabled() const {
+    Q_D(const ResourcesModel);
+    
+    return d->request->cacheEnabled();
+}
+
+void ResourcesModel::setCacheEnabled(bool enabled) {
+    Q_D(ResourcesModel);
+    
+    if (enabled != d->request->cacheEnabled()) {
+        d->request->setCacheEnabled(enabled);
+        emit cacheEnabledChanged();
+    }
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::ResourcesModel::setCacheEnabled" << enabled;
+#endif
+}
+
+/*!
+    \property int ResourcesModel::timeout
+    \brief The maximum time in milliseconds that each request may take.
+    
+    The default is 0, meaning no timeout.
+    
+    \sa Request::timeout
+*/
+
+/*!
+    \fn void ResourcesModel::timeoutChanged()
+    \brief Emitted when the timeout changes.
+*/
+int ResourcesModel::timeout() const {
+    Q_D(const ResourcesModel);
+    
+    return d->request->timeout();
+}
+
+void ResourcesModel::setTimeout(int msecs) {
+    Q_D(ResourcesModel);
+    
+    if (msecs != d->request->timeout()) {
+        d->request->setTimeout(msecs);
+        emit timeoutChanged();
+    }
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::ResourcesModel::setTimeout" << msecs;
+#endif
+}
+
+/*!
+    \property int ResourcesModel::readTimeout
+    \brief The maximum time in milliseconds that each request waits for data from the server.
+    
+    The default is 0, meaning no timeout.
+    
+    \sa Request::readTimeout
+*/
+
+/*!
+    \fn void ResourcesModel::readTimeoutChanged()
+    \brief Emitted when the readTimeout changes.
+*/
+int ResourcesModel::readTimeout() const {
+    Q_D(const ResourcesModel);
+    
+    return d->request->readTimeout();
+}
+
+void ResourcesModel::setReadTimeout(int msecs) {
+    Q_D(ResourcesModel);
+    
+    if (msecs != d->request->readTimeout()) {
+        d->request->setReadTimeout(msecs);
+        emit readTimeoutChanged();
+    }
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::ResourcesModel::setReadTimeout" << msecs;
+#endif
+}
+
 /*!
     \brief Sets the QNetworkAccessManager instance to be used when making requests to the Vimeo Data API.
     
     ResourcesModel does not take ownership of \a manager.
     
-    If no QNetworkAccessManager is set, one will be created when required.
+    If no QNetworkAccessManager is set, the one returned by Network::networkAccessManager() is used.
     
     \sa ResourcesRequest::setNetworkAccessManager()
 */
@@ -402,8 +686,8 @@ void ResourcesModel::fetchMore(const QModelIndex &) {
         
         int page = d->filters.value("page").toInt();
         d->filters["page"] = (page > 0 ? page + 1 : 2);
-        connect(d->request, SIGNAL(finished()), this, SLOT(_q_onListRequestFinished()));
-        d->request->list(d->resourcePath, d->filters);
+        d->connectListRequest();
+        d->request->list(d->resourcePath, d->requestFilters());
         emit statusChanged(d->request->status());
     }
 }
@@ -419,8 +703,8 @@ void ResourcesModel::list(const QString &resourcePath, const QVariantMap &filter
         clear();
         d->resourcePath = resourcePath;
         d->filters = filters;
-        connect(d->request, SIGNAL(finished()), this, SLOT(_q_onListRequestFinished()));
-        d->request->list(d->resourcePath, d->filters);
+        d->connectListRequest();
+        d->request->list(d->resourcePath, d->requestFilters());
         emit statusChanged(d->request->status());
     }
 }
@@ -434,6 +718,7 @@ void ResourcesModel::insert(const QVariantMap &resource) {
     if (status() != ResourcesRequest::Loading) {
         Q_D(ResourcesModel);
         connect(d->request, SIGNAL(finished()), this, SLOT(_q_onInsertRequestFinished()));
+        d->request->setProjection(d->requestProjection(false));
         d->request->insert(resource, d->resourcePath);
         emit statusChanged(d->request->status());
     }
@@ -448,6 +733,7 @@ void ResourcesModel::insert(int row, const QString &resourcePath) {
     if (status() != ResourcesRequest::Loading) {
         Q_D(ResourcesModel);
         connect(d->request, SIGNAL(finished()), this, SLOT(_q_onInsertRequestFinished()));
+        d->request->setProjection(d->requestProjection(false));
         d->request->insert(QString("%1%2%3").arg(resourcePath)
                                             .arg(resourcePath.endsWith("/") ? QString() : QString("/"))
                                             .arg(get(row).value("uri").toString().section('/', -1)));
@@ -462,6 +748,7 @@ void ResourcesModel::update(int row, const QVariantMap &resource) {
     if (status() != ResourcesRequest::Loading) {
         Q_D(ResourcesModel);
         connect(d->request, SIGNAL(finished()), this, SLOT(_q_onUpdateRequestFinished()));
+        d->request->setProjection(d->requestProjection(false));
         d->request->update(get(row).value("uri").toString(), resource);
         emit statusChanged(d->request->status());
     }
@@ -519,8 +806,8 @@ void ResourcesModel::reload() {
             d->filters["page"] = 1;
         }
         
-        connect(d->request, SIGNAL(finished()), this, SLOT(_q_onListRequestFinished()));
-        d->request->list(d->resourcePath, d->filters);
+        d->connectListRequest();
+        d->request->list(d->resourcePath, d->requestFilters());
         emit statusChanged(d->request->status());
     }
 }
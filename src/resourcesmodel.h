@@ -36,6 +36,11 @@ class QVIMEOSHARED_EXPORT ResourcesModel : public Model
     Q_PROPERTY(QVariant result READ result NOTIFY statusChanged)
     Q_PROPERTY(QVimeo::ResourcesRequest::Error error READ error NOTIFY statusChanged)
     Q_PROPERTY(QString errorString READ errorString NOTIFY statusChanged)
+    Q_PROPERTY(bool progressive READ progressive WRITE setProgressive NOTIFY progressiveChanged)
+    Q_PROPERTY(QStringList projection READ projection WRITE setProjection NOTIFY projectionChanged)
+    Q_PROPERTY(bool cacheEnabled READ cacheEnabled WRITE setCacheEnabled NOTIFY cacheEnabledChanged)
+    Q_PROPERTY(int timeout READ timeout WRITE setTimeout NOTIFY timeoutChanged)
+    Q_PROPERTY(int readTimeout READ readTimeout WRITE setReadTimeout NOTIFY readTimeoutChanged)
                 
 public: 
     explicit ResourcesModel(QObject *parent = 0);
@@ -56,6 +61,21 @@ public:
     ResourcesRequest::Error error() const;
     QString errorString() const;
     
+    bool progressive() const;
+    void setProgressive(bool enabled);
+    
+    QStringList projection() const;
+    void setProjection(const QStringList &paths);
+    
+    bool cacheEnabled() const;
+    void setCacheEnabled(bool enabled);
+    
+    int timeout() const;
+    void setTimeout(int msecs);
+    
+    int readTimeout() const;
+    void setReadTimeout(int msecs);
+    
     void setNetworkAccessManager(QNetworkAccessManager *manager);
     
     bool canFetchMore(const QModelIndex &parent = QModelIndex()) const;
@@ -82,11 +102,17 @@ Q_SIGNALS:
     void clientSecretChanged();
     void accessTokenChanged(const QString &token);
     void statusChanged(QVimeo::ResourcesRequest::Status s);
+    void progressiveChanged();
+    void projectionChanged();
+    void cacheEnabledChanged();
+    void timeoutChanged();
+    void readTimeoutChanged();
     
 private:        
     Q_DECLARE_PRIVATE(ResourcesModel)
     Q_DISABLE_COPY(ResourcesModel)
     
+    Q_PRIVATE_SLOT(d_func(), void _q_onListRequestItemsReady(QVariantList))
     Q_PRIVATE_SLOT(d_func(), void _q_onListRequestFinished())
     Q_PRIVATE_SLOT(d_func(), void _q_onInsertRequestFinished())
     Q_PRIVATE_SLOT(d_func(), void _q_onUpdateRequestFinished())
@@ -0,0 +1,246 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "retrypolicy.h"
+#include "request.h"
+#include <QDateTime>
+#include <QThread>
+#include <QThreadStorage>
+#include <qmath.h>
+
+namespace QVimeo {
+
+static QThreadStorage<bool> seeded;
+
+// Each thread has its own qrand() sequence, which must not be the same in every process
+static double randomFraction() {
+    if (!seeded.hasLocalData()) {
+        qsrand(uint(QDateTime::currentMSecsSinceEpoch()) ^ uint(quintptr(QThread::currentThreadId())));
+        seeded.setLocalData(true);
+    }
+
+    return double(qrand()) / RAND_MAX;
+}
+
+static QList<int> defaultErrors() {
+    QList<int> errors;
+    errors << Request::ConnectionRefusedError << Request::RemoteHostClosedError << Request::TimeoutError
+           << Request::TemporaryNetworkFailureError << Request::UnknownNetworkError;
+    return errors;
+}
+
+static QList<int> defaultStatusCodes() {
+    QList<int> codes;
+    codes << 429 << 500 << 502 << 503 << 504;
+    return codes;
+}
+
+/*!
+    \class RetryPolicy
+    \brief Describes when and how often a failed request is retried.
+
+    \ingroup requests
+
+    A request that fails with one of errors(), or whose response has one of statusCodes(), is retried up to 
+    maximumRetries() times. The delay before each retry grows from initialDelay() by backoffFactor() up to 
+    maximumDelay(), and a random part of it, given by jitter(), is removed so that clients that failed 
+    together do not all retry together. If the response has a Retry-After header, the request waits at least 
+    that long.
+
+    Only requests that can safely be repeated (HEAD, GET, PUT and DELETE) are retried after a network error or 
+    server error. Any request is retried if the response has status 429 Too Many Requests, as it was not 
+    processed.
+
+    The default policy does not retry.
+
+    Example usage:
+
+    \code
+    using namespace QVimeo;
+
+    ...
+
+    RetryPolicy policy(3);
+    policy.setInitialDelay(500);
+    request->setRetryPolicy(policy);
+    \endcode
+
+    \sa Request::setRetryPolicy()
+*/
+
+/*!
+    \brief Constructs a policy that does not retry.
+*/
+RetryPolicy::RetryPolicy() :
+    maxRetries(0),
+    firstDelay(1000),
+    maxDelay(30000),
+    factor(2.0),
+    jitterFraction(0.5),
+    errorList(defaultErrors()),
+    statusCodeList(defaultStatusCodes())
+{
+}
+
+/*!
+    \brief Constructs a policy that retries up to \a maximumRetries times.
+*/
+RetryPolicy::RetryPolicy(int maximumRetries) :
+    maxRetries(qMax(0, maximumRetries)),
+    firstDelay(1000),
+    maxDelay(30000),
+    factor(2.0),
+    jitterFraction(0.5),
+    errorList(defaultErrors()),
+    statusCodeList(defaultStatusCodes())
+{
+}
+
+/*!
+    \brief Returns the maximum number of times that a request is retried.
+
+    The default is 0.
+*/
+int RetryPolicy::maximumRetries() const {
+    return maxRetries;
+}
+
+/*!
+    \brief Sets the maximum number of times that a request is retried to \a retries.
+*/
+void RetryPolicy::setMaximumRetries(int retries) {
+    maxRetries = qMax(0, retries);
+}
+
+/*!
+    \brief Returns the delay before the first retry, in milliseconds.
+
+    The default is 1000.
+*/
+int RetryPolicy::initialDelay() const {
+    return firstDelay;
+}
+
+/*!
+    \brief Sets the delay before the first retry to \a msecs.
+*/
+void RetryPolicy::setInitialDelay(int msecs) {
+    firstDelay = qMax(0, msecs);
+}
+
+/*!
+    \brief Returns the maximum delay before a retry, in milliseconds.
+
+    The default is 30000.
+*/
+int RetryPolicy::maximumDelay() const {
+    return maxDelay;
+}
+
+/*!
+    \brief Sets the maximum delay before a retry to \a msecs.
+*/
+void RetryPolicy::setMaximumDelay(int msecs) {
+    maxDelay = qMax(0, msecs);
+}
+
+/*!
+    \brief Returns the factor by which the delay grows with each retry.
+
+    The default is 2.0, so the delay doubles each time. A factor of 1.0 gives a constant delay.
+*/
+double RetryPolicy::backoffFactor() const {
+    return factor;
+}
+
+/*!
+    \brief Sets the factor by which the delay grows with each retry to \a factor.
+*/
+void RetryPolicy::setBackoffFactor(double factor) {
+    this->factor = qMax(1.0, factor);
+}
+
+/*!
+    \brief Returns the largest fraction of each delay that is randomly removed.
+
+    The default is 0.5, so each delay is between half and all of the backoff delay. A jitter of 0.0 disables 
+    randomization, and 1.0 gives delays anywhere between 0 and the backoff delay.
+*/
+double RetryPolicy::jitter() const {
+    return jitterFraction;
+}
+
+/*!
+    \brief Sets the largest fraction of each delay that is randomly removed to \a jitter.
+*/
+void RetryPolicy::setJitter(double jitter) {
+    jitterFraction = qBound(0.0, jitter, 1.0);
+}
+
+/*!
+    \brief Returns the Request::Error values after which a request is retried.
+
+    The default is ConnectionRefusedError, RemoteHostClosedError, TimeoutError, TemporaryNetworkFailureError 
+    and UnknownNetworkError.
+*/
+QList<int> RetryPolicy::errors() const {
+    return errorList;
+}
+
+/*!
+    \brief Sets the Request::Error values after which a request is retried to \a errors.
+*/
+void RetryPolicy::setErrors(const QList<int> &errors) {
+    errorList = errors;
+}
+
+/*!
+    \brief Returns the HTTP status codes after which a request is retried.
+
+    The default is 429, 500, 502, 503 and 504.
+*/
+QList<int> RetryPolicy::statusCodes() const {
+    return statusCodeList;
+}
+
+/*!
+    \brief Sets the HTTP status codes after which a request is retried to \a codes.
+*/
+void RetryPolicy::setStatusCodes(const QList<int> &codes) {
+    statusCodeList = codes;
+}
+
+/*!
+    \brief Returns true if a request that failed with \a error and HTTP \a statusCode should be retried.
+*/
+bool RetryPolicy::isRetryable(int error, int statusCode) const {
+    if ((maxRetries <= 0) || (error == Request::OperationCanceledError)) {
+        return false;
+    }
+
+    return (statusCodeList.contains(statusCode)) || (errorList.contains(error));
+}
+
+/*!
+    \brief Returns the delay before \a retry, in milliseconds, where the first retry is 1.
+*/
+int RetryPolicy::delay(int retry) const {
+    const double backoff = qMin(double(maxDelay), firstDelay * qPow(factor, qMax(0, retry - 1)));
+
+    return int(backoff * (1.0 - jitterFraction * randomFraction()));
+}
+
+}
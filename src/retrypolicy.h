@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QVIMEO_RETRYPOLICY_H
+#define QVIMEO_RETRYPOLICY_H
+
+#include "qvimeo_global.h"
+#include <QList>
+
+namespace QVimeo {
+
+class QVIMEOSHARED_EXPORT RetryPolicy
+{
+
+public:
+    RetryPolicy();
+    explicit RetryPolicy(int maximumRetries);
+
+    int maximumRetries() const;
+    void setMaximumRetries(int retries);
+
+    int initialDelay() const;
+    void setInitialDelay(int msecs);
+
+    int maximumDelay() const;
+    void setMaximumDelay(int msecs);
+
+    double backoffFactor() const;
+    void setBackoffFactor(double factor);
+
+    double jitter() const;
+    void setJitter(double jitter);
+
+    QList<int> errors() const;
+    void setErrors(const QList<int> &errors);
+
+    QList<int> statusCodes() const;
+    void setStatusCodes(const QList<int> &codes);
+
+    bool isRetryable(int error, int statusCode) const;
+
+    int delay(int retry) const;
+
+private:
+    int maxRetries;
+    int firstDelay;
+    int maxDelay;
+    double factor;
+    double jitterFraction;
+    QList<int> errorList;
+    QList<int> statusCodeList;
+};
+
+}
+
+#endif // QVIMEO_RETRYPOLICY_H
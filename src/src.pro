@@ -6,40 +6,60 @@ TEMPLATE = lib
 QT += network
 QT -= gui
 
+LIBS += -lz
+
 TARGET = qvimeo
 DESTDIR = ../lib
 
 HEADERS += \
     authenticationrequest.h \
+    cache.h \
+    cache_p.h \
+    dispatcher.h \
     json.h \
     model.h \
     model_p.h \
+    network.h \
     qvimeo_global.h \
+    ratelimit.h \
+    ratelimit_p.h \
     request.h \
     request_p.h \
     resourcesmodel.h \
     resourcesrequest.h \
+    retrypolicy.h \
     streamsmodel.h \
     streamsrequest.h \
     urls.h
 
 SOURCES += \
     authenticationrequest.cpp \
+    cache.cpp \
+    dispatcher.cpp \
     json.cpp \
     model.cpp \
+    network.cpp \
+    ratelimit.cpp \
     request.cpp \
     resourcesmodel.cpp \
     resourcesrequest.cpp \
+    retrypolicy.cpp \
     streamsmodel.cpp \
     streamsrequest.cpp
     
 headers.files += \
     authenticationrequest.h \
+    cache.h \
+    dispatcher.h \
+    json.h \
     model.h \
+    network.h \
     qvimeo_global.h \
+    ratelimit.h \
     request.h \
     resourcesmodel.h \
     resourcesrequest.h \
+    retrypolicy.h \
     streamsmodel.h \
     streamsrequest.h \
     urls.h
@@ -16,6 +16,9 @@
 
 #include "streamsmodel.h"
 #include "model_p.h"
+#ifdef QVIMEO_DEBUG
+#include <QDebug>
+#endif
 
 namespace QVimeo {
 
@@ -226,12 +229,74 @@ QString StreamsModel::errorString() const {
     return d->request->errorString();
 }
 
+/*!
+    \property int StreamsModel::timeout
+    \brief The maximum time in milliseconds that each request may take.
+    
+    The default is 0, meaning no timeout.
+    
+    \sa Request::timeout
+*/
+
+/*!
+    \fn void StreamsModel::timeoutChanged()
+    \brief Emitted when the timeout changes.
+*/
+int StreamsModel::timeout() const {
+    Q_D(const StreamsModel);
+    
+    return d->request->timeout();
+}
+
+void StreamsModel::setTimeout(int msecs) {
+    Q_D(StreamsModel);
+    
+    if (msecs != d->request->timeout()) {
+        d->request->setTimeout(msecs);
+        emit timeoutChanged();
+    }
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::StreamsModel::setTimeout" << msecs;
+#endif
+}
+
+/*!
+    \property int StreamsModel::readTimeout
+    \brief The maximum time in milliseconds that each request waits for data from the server.
+    
+    The default is 0, meaning no timeout.
+    
+    \sa Request::readTimeout
+*/
+
+/*!
+    \fn void StreamsModel::readTimeoutChanged()
+    \brief Emitted when the readTimeout changes.
+*/
+int StreamsModel::readTimeout() const {
+    Q_D(const StreamsModel);
+    
+    return d->request->readTimeout();
+}
+
+void StreamsModel::setReadTimeout(int msecs) {
+    Q_D(StreamsModel);
+    
+    if (msecs != d->request->readTimeout()) {
+        d->request->setReadTimeout(msecs);
+        emit readTimeoutChanged();
+    }
+#ifdef QVIMEO_DEBUG
+    qDebug() << "QVimeo::StreamsModel::setReadTimeout" << msecs;
+#endif
+}
+
 /*!
     \brief Sets the QNetworkAccessManager instance to be used when making requests.
     
     StreamsModel does not take ownership of \a manager.
     
-    If no QNetworkAccessManager is set, one will be created when required.
+    If no QNetworkAccessManager is set, the one returned by Network::networkAccessManager() is used.
     
     \sa StreamsRequest::setNetworkAccessManager()
 */
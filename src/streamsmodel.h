@@ -32,6 +32,8 @@ class QVIMEOSHARED_EXPORT StreamsModel : public Model
     Q_PROPERTY(QVariant result READ result NOTIFY statusChanged)
     Q_PROPERTY(QVimeo::StreamsRequest::Error error READ error NOTIFY statusChanged)
     Q_PROPERTY(QString errorString READ errorString NOTIFY statusChanged)
+    Q_PROPERTY(int timeout READ timeout WRITE setTimeout NOTIFY timeoutChanged)
+    Q_PROPERTY(int readTimeout READ readTimeout WRITE setReadTimeout NOTIFY readTimeoutChanged)
                 
 public:
     enum Roles {
@@ -52,6 +54,12 @@ public:
     StreamsRequest::Error error() const;
     QString errorString() const;
     
+    int timeout() const;
+    void setTimeout(int msecs);
+    
+    int readTimeout() const;
+    void setReadTimeout(int msecs);
+    
     void setNetworkAccessManager(QNetworkAccessManager *manager);
     
 public Q_SLOTS:
@@ -62,6 +70,8 @@ public Q_SLOTS:
     
 Q_SIGNALS:
     void statusChanged(QVimeo::StreamsRequest::Status s);
+    void timeoutChanged();
+    void readTimeoutChanged();
     
 private:        
     Q_DECLARE_PRIVATE(StreamsModel)
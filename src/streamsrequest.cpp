@@ -30,14 +30,26 @@ public:
     {
     }
     
+    bool canParseIncrementally() const {
+        return false;
+    }
+    
+    bool canCacheResult() const {
+        return false;
+    }
+    
     void _q_onReplyFinished() {
         if (!reply) {
             return;
         }
+        
+        if (redirectOrRetry()) {
+            return;
+        }
     
         Q_Q(StreamsRequest);
         
-        const QString response = reply->readAll();
+        const QByteArray response = readReply();
         const QNetworkReply::NetworkError e = reply->error();
         const QString es = reply->errorString();
         reply->deleteLater();
@@ -47,9 +59,7 @@ public:
         case QNetworkReply::NoError:
             break;
         case QNetworkReply::OperationCanceledError:
-            setStatus(Request::Canceled);
-            setError(Request::NoError);
-            setErrorString(QString());
+            setCanceled();
             emit q->finished();
             return;
         default:
@@ -60,9 +70,18 @@ public:
             return;
         }
         
-        bool ok;
-        const QVariantList formats = QtJson::Json::parse(response.section("\"progressive\":", 1, 1)
-                                                                 .section("]", 0, 0) + "]", ok).toList();
+        bool ok = false;
+        QVariantList formats;
+        const int start = response.indexOf("\"progressive\":");
+        
+        if (start != -1) {
+            const int from = start + 14;
+            const int end = response.indexOf(']', from);
+            
+            if (end != -1) {
+                formats = QtJson::Json::parse(response.constData() + from, end - from + 1, ok).toList();
+            }
+        }
         
         if (ok) {
             QVariantList list;
@@ -47,6 +47,8 @@ Rectangle {
             clientId: "b73846eb250c788a08bda2458be6ae9aebfda98e"
             clientSecret: "6d6a7f4b5f013efe183f12d6e09be31051eb5eed"
             accessToken: "1016a25c36458be921de6a2325489766"
+            // Only the values used by the delegate are requested and kept
+            projection: ["name", "user.name", "pictures.sizes[*].link"]
             onStatusChanged: if (status == ResourcesRequest.Failed) console.log("ResourcesModel error: " + errorString);
         }
         delegate: Item {